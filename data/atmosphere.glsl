@@ -0,0 +1,137 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+// atmosphere scattering model shared by the
+// main pass and the lookup table bakes.
+// define ATMOSPHERE_TRANSMITTANCE_LUT and
+// declare transmittance_texture before
+// including to read light depths from the
+// transmittance lut instead of marching.
+
+const float PI = 3.14159265;
+
+// planet's atmosphere constants-earth by default
+const float SCATTER_IN_STEP = 16.0;
+const float SCATTER_DEPTH_STEP = 4.0;
+const float radius_surface = 6360e3;
+const float radius_atmosphere = 6380e3;
+const float sun_intensity = 10.0;
+const vec3 rayleigh_coefficient = vec3(58e-7, 135e-7, 331e-7);
+const vec3 mie_coefficient_upper = vec3(2e-5);
+const vec3 mie_coefficient_lower = mie_coefficient_upper * 1.1;
+const vec3 earth_center = vec3(0.0, -radius_surface, 0.0);
+
+vec2 atmosphere_density(vec3 point);
+float atmosphere_march(vec3 origin, vec3 direction, float radius);
+vec2 atmosphere_light_depth(vec3 point, vec3 light_direction);
+vec3 atmosphere_scatter(vec3 origin, vec3 direction, float l, vec3 light_direction);
+vec2 transmittance_uv(float h, float mu);
+vec2 sky_view_uv(vec3 direction);
+
+// ---------------------------- //
+// -------- atmosphere -------- //
+// ---------------------------- //
+
+vec2 atmosphere_density(vec3 point) {
+	float h = max(0.0, length(point - earth_center) - radius_surface);
+	return vec2(exp(-h / 8e3), exp(-h / 12e2));
+}
+
+float atmosphere_march(vec3 origin, vec3 direction, float radius) {
+	// origin - earth center
+	vec3 v = origin - earth_center;
+	float b = dot(v, direction);
+	float d = b * b - dot(v, v) + radius * radius;
+	if (d < 0.) return -1.;
+	d = sqrt(d);
+	float r1 = -b - d, r2 = -b + d;
+	return (r1 >= 0.) ? r1 : r2;
+}
+
+// optical depth (rayleigh, mie) from a point
+// to the top of the atmosphere toward the light
+#ifdef ATMOSPHERE_TRANSMITTANCE_LUT
+vec2 atmosphere_light_depth(vec3 point, vec3 light_direction) {
+	vec3 up = point - earth_center;
+	float h = length(up) - radius_surface;
+	return texture(transmittance_texture, transmittance_uv(h, dot(up, light_direction) / length(up))).rg;
+}
+#else
+vec2 atmosphere_light_depth(vec3 point, vec3 light_direction) {
+	float l_sde = atmosphere_march(point, light_direction, radius_atmosphere);
+	vec2 depth_accumulation = vec2(0.0);
+	l_sde /= SCATTER_DEPTH_STEP;
+	vec3 direction_sde = light_direction * l_sde;
+	// iterate point
+	for (int j = 0; j < SCATTER_DEPTH_STEP; ++j) {
+		depth_accumulation += atmosphere_density(point + direction_sde * j);
+	}
+	return depth_accumulation * l_sde;
+}
+#endif
+
+vec3 atmosphere_scatter(vec3 origin, vec3 direction, float l, vec3 light_direction) {
+	// scatter in
+	vec2 total_depth = vec2(0.0);
+	vec3 intensity_rayleigh = vec3(0.0);
+	vec3 intensity_mie = vec3(0.0);
+	{
+		float l_sin = l / SCATTER_IN_STEP;
+		vec3 direction_sin = direction * l_sin;
+
+		// iterate point
+		for (int i = 0; i < SCATTER_IN_STEP; ++i) {
+			vec3 point = origin + direction_sin * i;		
+			vec2 depth = atmosphere_density(point) * l_sin;
+			total_depth += depth;
+
+			// calculate scatter depth
+			vec2 depth_accumulation = atmosphere_light_depth(point, light_direction);
+
+			vec2 depth_sum = total_depth + depth_accumulation;
+
+			vec3 a = exp(-rayleigh_coefficient * depth_sum.x - mie_coefficient_upper * depth_sum.y);
+
+			intensity_rayleigh += a * depth.x;
+			intensity_mie += a * depth.y;
+		}
+	}
+
+	float mu = dot(direction, light_direction);
+
+	return sqrt(sun_intensity * (1.0 + mu * mu) * (intensity_rayleigh * rayleigh_coefficient * 0.0597 + intensity_mie * mie_coefficient_lower * 0.0196 / pow(1.58 - 1.52 * mu, 1.5)));
+}
+
+// ---- lookup tables ---- //
+
+// transmittance lut
+// x -> cosine of the angle to the zenith
+// y -> height, denser close to the ground
+vec2 transmittance_uv(float h, float mu) {
+	float height = clamp(h / (radius_atmosphere - radius_surface), 0.0, 1.0);
+	return vec2(mu * 0.5 + 0.5, sqrt(height));
+}
+
+void transmittance_parameters(vec2 uv, out float h, out float mu) {
+	mu = uv.x * 2.0 - 1.0;
+	h = uv.y * uv.y * (radius_atmosphere - radius_surface);
+}
+
+// sky view lut
+// x -> azimuth
+// y -> elevation, denser around the horizon
+vec2 sky_view_uv(vec3 direction) {
+	float azimuth = atan(direction.z, direction.x);
+	float elevation = asin(clamp(direction.y, -1.0, 1.0));
+	float v = sqrt(abs(elevation) / (PI * 0.5));
+	return vec2(azimuth / (2.0 * PI) + 0.5, 0.5 + 0.5 * sign(elevation) * v);
+}
+
+vec3 sky_view_direction(vec2 uv) {
+	float azimuth = (uv.x - 0.5) * 2.0 * PI;
+	float v = uv.y * 2.0 - 1.0;
+	float elevation = sign(v) * v * v * PI * 0.5;
+	return vec3(cos(elevation) * cos(azimuth), sin(elevation), cos(elevation) * sin(azimuth));
+}
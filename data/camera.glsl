@@ -0,0 +1,22 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+uniform vec3 camera_location;
+uniform mat4 view_matrix;
+// where the rendered image's pixels sit in
+// the frame. zero unless it's a tile of a
+// larger still, rendered with the frame's
+// resolution.
+uniform vec2 pixel_offset;
+
+// world space direction of the ray through a
+// pixel of an image of the given size
+vec3 ray_direction(vec2 pixel, vec2 size) {
+	vec2 uv = pixel / size * 2.0 - 1.0;
+	uv.x *= size.x / size.y;
+	vec4 dir = vec4(normalize(vec3(uv, -2.0)), 1.0);
+	dir = view_matrix * dir;
+	return dir.xyz;
+}
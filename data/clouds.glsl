@@ -0,0 +1,219 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+// cloud density model shared by the main
+// pass and the passes that precompute parts
+// of it.
+
+// ---------------------------- //
+// -------- parameters -------- //
+// ---------------------------- //
+
+#include "parameters.glsl"
+
+uniform int frame;
+// how far the wind has carried the clouds.
+// set per frame, or per second of a sequence
+uniform float animation_time;
+
+// textures
+uniform sampler3D occupancy_texture;
+uniform sampler3D noise_main_texture;
+uniform sampler2D noise_weather_texture;
+uniform sampler3D noise_detail_texture;
+uniform sampler2DArray noise_weather_clipmap_texture;
+// main and detail in one texture. detail is
+// baked in main noise space, so it follows
+// main's offset and wind.
+uniform sampler3D noise_packed_texture;
+
+// ---- clouds ---- declarations ---- //
+float mie_density(vec3 position, float footprint);
+float mie_coverage(vec3 position);
+float noise_lod(sampler3D noise, float scale, float footprint);
+float noise_weather(vec2 location);
+float henyey_greenstein(float x, float y);
+float mie_light_depth(vec3 position, float footprint);
+vec2 ray_to_cloud(vec3 origin, vec3 inverted_direction, vec3 vol_left_bound, vec3 vol_right_bound);
+bool cloud_cell_empty(vec3 position);
+float cloud_empty_distance(vec3 position, vec3 direction, float max_distance);
+// ------------------------------- //
+
+// --------------------- //
+// -------- mie -------- //
+// --------------------- //
+
+// footprint is the width, in world units, of
+// the region the sample stands for. noise is
+// read from the mip level that matches it.
+float mie_density(vec3 position, float footprint) {
+	float time = animation_time;
+
+	// main cloud shape noise
+	vec3 main_sample_location = position / noise_main_scale + noise_main_offset + wind_vector * wind_main_weight * time;
+	vec4 noise;
+	if (noise_packed == 1) {
+		noise = textureLod(noise_packed_texture, main_sample_location, noise_lod(noise_packed_texture, noise_main_scale, footprint));
+	} else {
+		noise.r = textureLod(noise_main_texture, main_sample_location, noise_lod(noise_main_texture, noise_main_scale, footprint)).r;
+	}
+	float main_noise_fbm = noise.r;
+
+	// total density at current point obtained from these values
+	float density = max(0.0, main_noise_fbm * mie_coverage(position) - cloud_density_threshold);
+
+	if (density > 0.0) {
+		// add detail to cloud's shape
+		float detail_noise_fbm = noise.g;
+		if (noise_packed == 0) {
+			vec3 detail_sample_location = position / noise_detail_scale + noise_detail_offset + wind_vector * wind_detail_weight * time;
+			detail_noise_fbm = textureLod(noise_detail_texture, detail_sample_location, noise_lod(noise_detail_texture, noise_detail_scale, footprint)).r;
+		}
+		density -= detail_noise_fbm * noise_detail_weight;
+		return max(0.0, density * cloud_density_multiplier);
+	}
+	return 0.0;
+}
+
+// every factor of the density but the 3d
+// noise layers. main noise is at most one,
+// so no cloud can exist where this is under
+// the density threshold.
+float mie_coverage(vec3 position) {
+	float time = animation_time;
+	vec3 lower_bound = cloud_location - cloud_volume;
+	vec3 upper_bound = cloud_location + cloud_volume;
+
+	// edge weight.
+	// to not cut off the clouds abruptly
+	float distance_edge_x = min(cloud_volume_edge_fade_distance, min(position.x - lower_bound.x, upper_bound.x - position.x));
+	float distance_edge_z = min(cloud_volume_edge_fade_distance, min(position.z - lower_bound.z, upper_bound.z - position.z));
+	float edge_weight = min(distance_edge_x, distance_edge_z) / cloud_volume_edge_fade_distance;
+
+	// !!! -> round cloud based on height - probably not an efficient approach
+	// https://www.desmos.com/calculator/lg2fhwtxvo
+	float height = 1.0 - pow((position.y - lower_bound.y) / (2.0 * cloud_volume.y), 4);
+
+	// 2d worley noise to decide where can clouds be rendered
+	vec2 weather_sample_location = position.xz / noise_weather_scale + noise_weather_offset + wind_vector.xz * wind_weather_weight * time;
+	float weather = max(noise_weather(weather_sample_location), 0.0);
+	weather = max(weather - cloud_density_threshold, 0.0);
+
+	return height * weather * edge_weight;
+}
+
+// approximation of a mie phase function
+// -> due to mie scattering's complexity, 
+//    an approximation is used.
+// -> an even cheaper alternative, if 
+//    needed, is be the Schlik phase 
+//    function, which doesn't use pow.
+//
+float henyey_greenstein(float g, float angle_cos) {
+	float g2 = g * g;
+	return (1.0 - g2) / (pow(1 + g2 - 2 * g * angle_cos, 1.5));
+}
+
+// weather at a point of the weather plane,
+// from the finest clipmap level around it
+// when the clipmap is on
+float noise_weather(vec2 location) {
+	if (noise_weather_clipmap == 0) {
+		return texture(noise_weather_texture, location).r;
+	}
+	ivec2 size = textureSize(noise_weather_clipmap_texture, 0).xy;
+	float texel_size = noise_weather_clipmap_texel_size;
+	for (int level = 0; level < noise_weather_clipmap_levels; ++level) {
+		vec2 texel = location / texel_size;
+		// a texel's margin for filtering
+		if (all(lessThan(abs(texel - vec2(noise_weather_clipmap_centers[level])), vec2(size / 2 - 1)))) {
+			return textureLod(noise_weather_clipmap_texture, vec3(texel / vec2(size), float(level)), 0.0).r;
+		}
+		texel_size *= 2.0;
+	}
+	// past the last level
+	return 0.0;
+}
+
+// mip level at which a texel of a noise
+// texture repeated every scale units is as
+// wide as footprint
+float noise_lod(sampler3D noise, float scale, float footprint) {
+	if (render_noise_lod == 0) return 0.0;
+	float texels = footprint * float(textureSize(noise, 0).x) / scale;
+	return log2(max(texels, 1.0));
+}
+
+// optical depth from a point in the volume
+// toward the light, capped to the shadowing
+// distance.
+// samples are taken along a cone that starts
+// at footprint and widens with the distance
+// to the point, as shadows blur with it.
+float mie_light_depth(vec3 position, float footprint) {
+	float distance_inside_volume = ray_to_cloud(position, inverse_light_direction, cloud_location - cloud_volume, cloud_location + cloud_volume).y;
+	distance_inside_volume = min(render_shadowing_max_distance, distance_inside_volume);
+	float step_size = distance_inside_volume / float(render_in_scatter_samples);
+	float total_density = 0.0;
+	for (int i = 0; i < render_in_scatter_samples; ++i) {
+		if (render_empty_space_skipping == 0 || !cloud_cell_empty(position)) {
+			float cone = footprint + step_size * float(i) * 0.5;
+			total_density += (mie_density(position, cone) * step_size);
+		}
+		position += light_direction * step_size;
+	}
+	return total_density;
+}
+
+// ---- empty space ---- //
+// the occupancy grid splits the cloud volume
+// in cells, each flagged if any point inside
+// could have some density.
+
+bool cloud_cell_empty(vec3 position) {
+	ivec3 cells = textureSize(occupancy_texture, 0);
+	vec3 lower_bound = cloud_location - cloud_volume;
+	ivec3 cell = ivec3(floor((position - lower_bound) / (2.0 * cloud_volume) * vec3(cells)));
+	cell = clamp(cell, ivec3(0), cells - 1);
+	return texelFetch(occupancy_texture, cell, 0).r == 0.0;
+}
+
+// distance along the ray that can be skipped
+// from position, walking through consecutive
+// empty cells. zero if position's cell isn't
+// empty.
+float cloud_empty_distance(vec3 position, vec3 direction, float max_distance) {
+	ivec3 cells = textureSize(occupancy_texture, 0);
+	vec3 lower_bound = cloud_location - cloud_volume;
+	vec3 cell_size = 2.0 * cloud_volume / vec3(cells);
+	vec3 inverted_direction = 1.0 / direction;
+	float skipped = 0.0;
+	for (int i = 0; i < 16 && skipped < max_distance; ++i) {
+		vec3 point = position + direction * skipped;
+		if (!cloud_cell_empty(point)) break;
+		// exit distance from this cell
+		vec3 cell_min = lower_bound + floor((point - lower_bound) / cell_size) * cell_size;
+		vec3 t = (cell_min + step(0.0, direction) * cell_size - point) * inverted_direction;
+		skipped += min(t.x, min(t.y, t.z)) + 1e-3;
+	}
+	return skipped;
+}
+
+// from
+// http://jcgt.org/published/0007/03/04/
+// returns float2:
+// 	x -> distance to cloud volume
+// 	y -> distance across cloud volume
+vec2 ray_to_cloud(vec3 origin, vec3 inverted_direction, vec3 vol_left_bound, vec3 vol_right_bound) {
+	vec3 t0 = (vol_left_bound - origin) * inverted_direction;
+	vec3 t1 = (vol_right_bound - origin) * inverted_direction;
+	vec3 tmin = min(t0, t1);
+	vec3 tmax = max(t0, t1);
+	float dist_maxmin = max(max(tmin.x, tmin.y), tmin.z);
+	float dist_minmax = min(tmax.x, min(tmax.y, tmax.z));
+	float dist_to_volume = max(0.0, dist_maxmin);
+	float dist_across_volume = max(0.0, dist_minmax - dist_to_volume);
+	return vec2(dist_to_volume, dist_across_volume);
+}
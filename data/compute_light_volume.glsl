@@ -0,0 +1,24 @@
+#version 430
+layout(local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+layout(r16f, location = 0) uniform writeonly image3D output_texture;
+
+// first z slice written by this dispatch.
+// the volume can be refreshed a few slices
+// at a time.
+uniform int slice_offset;
+
+#include "clouds.glsl"
+
+// optical depth toward the light from every
+// voxel centre of the cloud volume. the main
+// pass fetches it instead of marching toward
+// the light from each of its samples.
+void main() {
+	ivec3 voxel = ivec3(gl_GlobalInvocationID) + ivec3(0, 0, slice_offset);
+	ivec3 voxels = imageSize(output_texture);
+	if (any(greaterThanEqual(voxel, voxels))) return;
+	vec3 lower_bound = cloud_location - cloud_volume;
+	vec3 voxel_size = 2.0 * cloud_volume / vec3(voxels);
+	vec3 position = lower_bound + (vec3(voxel) + 0.5) * voxel_size;
+	imageStore(output_texture, voxel, vec4(mie_light_depth(position, min(voxel_size.x, voxel_size.z))));
+}
@@ -2,19 +2,6 @@
 layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
 layout(r8, location = 0) uniform image3D output_texture;
 
-// point grid buffers (SSBOs)
-layout(std430, binding = 1) buffer points_a {
-	vec4 p_a[];
-};
-
-layout(std430, binding = 2) buffer points_b {
-	vec4 p_b[];
-};
-
-layout(std430, binding = 3) buffer points_c {
-	vec4 p_c[];
-};
-
 // ---- vars ---- //
 // per axis resolution of the texture
 uniform int resolution;
@@ -25,104 +12,65 @@ uniform float persistance;
 uniform int subdivisions_a;
 uniform int subdivisions_b;
 uniform int subdivisions_c;
+// the points of every layer are hashed from it
+uniform int seed;
+// first z slice of a time sliced bake
+uniform int slice_offset;
 
-int min_component(ivec3 x) {
-	return min(x.x, min(x.y, x.z));
-}
+#include "worley.glsl"
 
-int max_component(ivec3 x) {
-	return max(x.x, max(x.y, x.z));
-}
+// the points of the cells under a workgroup
+// and their neighbours, one layer at a time,
+// hashed once instead of by each texel. up to
+// 12 per axis -> 27kb, grids up to about a
+// cell per texel. finer ones hash directly.
+#define STAGED_CELLS 1728
+shared vec4 staged[STAGED_CELLS];
 
-const ivec3 offsets[27] = ivec3[27](
-	// centre
-	ivec3(0,0,0),
-	// front face
-	ivec3(0,0,1),
-	ivec3(-1,1,1),
-	ivec3(-1,0,1),
-	ivec3(-1,-1,1),
-	ivec3(0,1,1),
-	ivec3(0,-1,1),
-	ivec3(1,1,1),
-	ivec3(1,0,1),
-	ivec3(1,-1,1),
-	// back face
-	ivec3(0,0,-1),
-	ivec3(-1,1,-1),
-	ivec3(-1,0,-1),
-	ivec3(-1,-1,-1),
-	ivec3(0,1,-1),
-	ivec3(0,-1,-1),
-	ivec3(1,1,-1),
-	ivec3(1,0,-1),
-	ivec3(1,-1,-1),
-	// ring around centre
-	ivec3(-1,1,0),
-	ivec3(-1,0,0),
-	ivec3(-1,-1,0),
-	ivec3(0,1,0),
-	ivec3(0,-1,0),
-	ivec3(1,1,0),
-	ivec3(1,0,0),
-	ivec3(1,-1,0)
-);
+float compute_worley_layer_staged(int sub, int layer) {
+	uvec3 texel = gl_GlobalInvocationID + uvec3(0, 0, slice_offset);
+	vec3 position = vec3(texel) / resolution;
+	ivec3 cell_id = ivec3(floor(position * sub));
+	// first and last cell under the workgroup.
+	// the same for all its invocations, so the
+	// barriers below are reached by all or none
+	uvec3 first_texel = gl_WorkGroupID * gl_WorkGroupSize + uvec3(0, 0, slice_offset);
+	ivec3 first_cell = ivec3(floor(vec3(first_texel) / resolution * sub));
+	ivec3 last_cell = ivec3(floor(vec3(first_texel + gl_WorkGroupSize - 1u) / resolution * sub));
+	ivec3 span = last_cell - first_cell + 3;
+	int count = span.x * span.y * span.z;
+	if (count > STAGED_CELLS) {
+		return compute_worley_layer(position, sub, seed, layer);
+	}
+
+	// stage the neighbourhood, 512 points a pass
+	for (int i = int(gl_LocalInvocationIndex); i < count; i += 512) {
+		ivec3 staged_id = ivec3(i % span.x, (i / span.x) % span.y, i / (span.x * span.y));
+		staged[i] = vec4(worley_point(first_cell - 1 + staged_id, sub, seed, layer), 0.0);
+	}
+	barrier();
 
-// computes a layer of the noise
-float compute_worley_layer(vec3 pos, int sub, int point_grid_index) {
-	ivec3 cell_id = ivec3(floor(pos * sub));
+	ivec3 staged_id = cell_id - first_cell + 1;
 	float min_dist = 1.0;
-	for (int offset_index = 0; offset_index < 27; ++offset_index) {
-		ivec3 adj_id = cell_id + offsets[offset_index];
-		// if adj cell is outside, blend texture to it ->
-		// repeat seemlessly
-		if (min_component(adj_id) == -1 || max_component(adj_id) == sub) {
-			ivec3 wrapped_id = ivec3(mod(adj_id + ivec3(sub), vec3(sub)));
-			// get index
-			int adj_index = wrapped_id.x + sub * (wrapped_id.y + wrapped_id.z * sub);
-			vec3 wrapped_point;
-			if (point_grid_index == 0) {
-				wrapped_point = p_a[adj_index].xyz;
-			} else if (point_grid_index == 1) {
-				wrapped_point = p_b[adj_index].xyz;
-			} else {
-				wrapped_point = p_c[adj_index].xyz;
-			}
-			for (int wrapped_offset_index = 0; wrapped_offset_index < 27; ++wrapped_offset_index) {
-				vec3 difference = (pos - (wrapped_point + vec3(offsets[wrapped_offset_index])));
+	for (int z = -1; z <= 1; ++z) {
+		for (int y = -1; y <= 1; ++y) {
+			for (int x = -1; x <= 1; ++x) {
+				ivec3 adj_id = staged_id + ivec3(x, y, z);
+				vec3 difference = position - staged[adj_id.x + span.x * (adj_id.y + adj_id.z * span.y)].xyz;
 				min_dist = min(min_dist, dot(difference, difference));
 			}
-		} else {
-			// adj cell is inside known map
-			// calc distance from position to cell point
-			int adj_index = adj_id.x + sub * (adj_id.y + adj_id.z * sub);
-			vec3 difference = pos;
-			if (point_grid_index == 0) {
-				difference -= p_a[adj_index].xyz;
-			} else if (point_grid_index == 1) {
-				difference -= p_b[adj_index].xyz;
-			} else {
-				difference -= p_c[adj_index].xyz;
-			}
-			min_dist = min(min_dist, dot(difference, difference));
 		}
 	}
+	// the next layer overwrites the stage
+	barrier();
 	return sqrt(min_dist);
 }
 
 void main() {
-	vec3 position = vec3(gl_GlobalInvocationID) / resolution;
-	float layer_a = compute_worley_layer(position, subdivisions_a, 0);
-	float layer_b = compute_worley_layer(position, subdivisions_b, 1);
-	float layer_c = compute_worley_layer(position, subdivisions_c, 2);
-	// combine layers
-	float noise_sum = layer_a + (layer_b * persistance) + (layer_c * persistance * persistance);
-	// map to 0.0 - 1.0
-	noise_sum /= (1.0 + persistance + (persistance * persistance));
-	// invert
-	noise_sum = 1.0 - noise_sum;
-	// accentuate dark tones
-	noise_sum = noise_sum * noise_sum * noise_sum * noise_sum; // noise_sum^2
+	float layer_a = compute_worley_layer_staged(subdivisions_a, 0);
+	float layer_b = compute_worley_layer_staged(subdivisions_b, 1);
+	float layer_c = compute_worley_layer_staged(subdivisions_c, 2);
+	float noise_sum = combine_worley_layers(layer_a, layer_b, layer_c, persistance);
 	// write to texture
-	imageStore(output_texture, ivec3(gl_GlobalInvocationID), vec4(noise_sum));
+	imageStore(output_texture, ivec3(gl_GlobalInvocationID) + ivec3(0, 0, slice_offset), vec4(noise_sum));
 }
@@ -0,0 +1,24 @@
+#version 430
+layout(local_size_x = 8, local_size_y = 8) in;
+layout(r8, location = 0) uniform readonly image2D input_level;
+layout(r8, location = 1) uniform writeonly image2D output_level;
+
+// one level of a conservative max pyramid.
+// every output texel holds the maximum of
+// the input texels it covers, odd sizes
+// included.
+void main() {
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 input_size = imageSize(input_level);
+	ivec2 output_size = imageSize(output_level);
+	if (any(greaterThanEqual(texel, output_size))) return;
+	ivec2 first = (texel * input_size) / output_size;
+	ivec2 last = min(((texel + 1) * input_size + output_size - 1) / output_size, input_size) - 1;
+	float maximum = 0.0;
+	for (int y = first.y; y <= last.y; ++y) {
+		for (int x = first.x; x <= last.x; ++x) {
+			maximum = max(maximum, imageLoad(input_level, ivec2(x, y)).r);
+		}
+	}
+	imageStore(output_level, texel, vec4(maximum));
+}
@@ -0,0 +1,71 @@
+#version 430
+layout(local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+layout(r8, location = 0) uniform writeonly image3D output_texture;
+
+// ---- vars ---- //
+// max pyramid over the weather texture
+uniform sampler2D weather_max_texture;
+uniform int weather_resolution;
+uniform int weather_levels;
+// cloud
+uniform float cloud_density_threshold;
+uniform float cloud_volume_edge_fade_distance;
+uniform vec3 cloud_location;
+uniform vec3 cloud_volume;
+// weather offset at this frame, wind included
+uniform float noise_weather_scale;
+uniform vec2 noise_weather_offset;
+
+// marks a cell of the cloud volume as occupied
+// if any point inside it could have a density
+// over zero. every factor of mie_density is
+// bounded from above:
+// -> main noise <= 1
+// -> height and edge weights at the cell point
+//    that maximises them
+// -> weather at the max of its footprint
+void main() {
+	ivec3 cell = ivec3(gl_GlobalInvocationID);
+	ivec3 cells = imageSize(output_texture);
+	if (any(greaterThanEqual(cell, cells))) return;
+
+	vec3 lower_bound = cloud_location - cloud_volume;
+	vec3 upper_bound = cloud_location + cloud_volume;
+	vec3 cell_size = 2.0 * cloud_volume / vec3(cells);
+	vec3 cell_min = lower_bound + vec3(cell) * cell_size;
+	vec3 cell_max = cell_min + cell_size;
+
+	// height falls off toward the top
+	float height = 1.0 - pow(max(cell_min.y - lower_bound.y, 0.0) / (2.0 * cloud_volume.y), 4);
+
+	// edge weight peaks at the cell point
+	// closest to the volume's centre
+	vec3 inner = clamp(cloud_location, cell_min, cell_max);
+	float distance_edge_x = min(cloud_volume_edge_fade_distance, min(inner.x - lower_bound.x, upper_bound.x - inner.x));
+	float distance_edge_z = min(cloud_volume_edge_fade_distance, min(inner.z - lower_bound.z, upper_bound.z - inner.z));
+	float edge_weight = min(distance_edge_x, distance_edge_z) / cloud_volume_edge_fade_distance;
+
+	// weather footprint in texels, widened by a
+	// texel so that filtered lookups stay inside
+	vec2 footprint_min = (cell_min.xz / noise_weather_scale + noise_weather_offset) * weather_resolution - 1.0;
+	vec2 footprint_max = (cell_max.xz / noise_weather_scale + noise_weather_offset) * weather_resolution + 1.0;
+	float span = max(footprint_max.x - footprint_min.x, footprint_max.y - footprint_min.y);
+	// lowest level at which the footprint
+	// covers at most two texels per axis
+	int level = clamp(int(ceil(log2(max(span, 1.0)))), 0, weather_levels - 1);
+	ivec2 level_size = textureSize(weather_max_texture, level);
+	ivec2 first = ivec2(floor(footprint_min / float(1 << level)));
+	ivec2 last = ivec2(floor(footprint_max / float(1 << level)));
+	float weather = 0.0;
+	for (int y = first.y; y <= last.y; ++y) {
+		for (int x = first.x; x <= last.x; ++x) {
+			// weather repeats
+			ivec2 texel = ivec2(mod(vec2(x, y), vec2(level_size)));
+			weather = max(weather, texelFetch(weather_max_texture, texel, level).r);
+		}
+	}
+	weather = max(weather - cloud_density_threshold, 0.0);
+
+	float density = height * weather * edge_weight - cloud_density_threshold;
+	imageStore(output_texture, cell, vec4(density > 0.0 ? 1.0 : 0.0));
+}
@@ -0,0 +1,45 @@
+#version 430
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+layout(rgba8, location = 0) uniform writeonly image3D output_texture;
+
+// ---- vars ---- //
+// per axis resolution of the texture
+uniform int resolution;
+uniform float main_persistance;
+uniform float detail_persistance;
+uniform ivec3 main_subdivisions;
+uniform ivec3 detail_subdivisions;
+// times the detail noise repeats along each
+// axis of the main noise. same ratio as
+// between their scales.
+uniform int detail_repeat;
+// the points of main's and detail's layers
+// are hashed from them, the same as in their
+// own textures
+uniform int main_seed;
+uniform int detail_seed;
+
+#include "worley.glsl"
+
+// main and detail noise in a single texture,
+// so that both come from one fetch:
+// r -> main noise
+// g -> detail noise, in main noise space
+// b -> highest frequency main layer
+// a -> highest frequency detail layer
+void main() {
+	vec3 position = vec3(gl_GlobalInvocationID) / resolution;
+	vec3 detail_position = fract(position * float(detail_repeat));
+	float main_a = compute_worley_layer(position, main_subdivisions.x, main_seed, 0);
+	float main_b = compute_worley_layer(position, main_subdivisions.y, main_seed, 1);
+	float main_c = compute_worley_layer(position, main_subdivisions.z, main_seed, 2);
+	float detail_a = compute_worley_layer(detail_position, detail_subdivisions.x, detail_seed, 0);
+	float detail_b = compute_worley_layer(detail_position, detail_subdivisions.y, detail_seed, 1);
+	float detail_c = compute_worley_layer(detail_position, detail_subdivisions.z, detail_seed, 2);
+	vec4 noise;
+	noise.r = combine_worley_layers(main_a, main_b, main_c, main_persistance);
+	noise.g = combine_worley_layers(detail_a, detail_b, detail_c, detail_persistance);
+	noise.b = 1.0 - main_c;
+	noise.a = 1.0 - detail_c;
+	imageStore(output_texture, ivec3(gl_GlobalInvocationID), noise);
+}
@@ -0,0 +1,35 @@
+#version 430
+layout(local_size_x = 8, local_size_y = 8) in;
+layout(rgba16f, location = 0) uniform writeonly image2D output_texture;
+
+// classified by compute_tiles.glsl
+layout(std430, binding = 7) readonly buffer tiles {
+	uint cloud_groups[3];
+	uint sky_groups[3];
+	uint tile_list[];
+};
+
+uniform int tile_count;
+
+#include "render.glsl"
+
+// renders one 8x8 tile per work group. built
+// twice: the full renderer for tiles that
+// see clouds and, with SKY_ONLY, a sky only
+// one for the rest, which doesn't carry the
+// marcher's registers around.
+void main() {
+#ifdef SKY_ONLY
+	uint tile = tile_list[tile_count - 1 - gl_WorkGroupID.x];
+#else
+	uint tile = tile_list[gl_WorkGroupID.x];
+#endif
+	ivec2 texel = ivec2(tile & 0xffff, tile >> 16) * 8 + ivec2(gl_LocalInvocationID.xy);
+	if (any(greaterThanEqual(texel, imageSize(output_texture)))) return;
+	vec2 pixel = vec2(texel) + 0.5 + pixel_offset;
+#ifdef SKY_ONLY
+	imageStore(output_texture, texel, render_sky_pixel(pixel));
+#else
+	imageStore(output_texture, texel, render_pixel(pixel));
+#endif
+}
@@ -0,0 +1,22 @@
+#version 430
+layout(local_size_x = 8, local_size_y = 8) in;
+layout(rgba16f, location = 0) uniform writeonly image2D output_texture;
+
+uniform vec3 camera_location;
+uniform vec3 light_direction;
+uniform sampler2D transmittance_texture;
+
+#define ATMOSPHERE_TRANSMITTANCE_LUT
+#include "atmosphere.glsl"
+
+// sky color for every view direction as seen
+// from the camera. rebaked whenever the light
+// or the camera's height change.
+void main() {
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(output_texture);
+	if (any(greaterThanEqual(texel, size))) return;
+	vec3 direction = sky_view_direction((vec2(texel) + 0.5) / vec2(size));
+	float l = atmosphere_march(camera_location, direction, radius_atmosphere);
+	imageStore(output_texture, texel, vec4(atmosphere_scatter(camera_location, direction, l, light_direction), 1.0));
+}
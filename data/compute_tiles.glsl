@@ -0,0 +1,49 @@
+#version 430
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// tiles sorted by what they see. cloud tiles
+// fill the list from the front and sky tiles
+// from the back. both counts double as the
+// indirect dispatch arguments of the
+// kernels that render them.
+layout(std430, binding = 7) buffer tiles {
+	uint cloud_groups[3];
+	uint sky_groups[3];
+	uint tile_list[];
+};
+
+uniform vec2 resolution;
+
+#include "clouds.glsl"
+#include "camera.glsl"
+
+shared uint tile_hit;
+
+// one work group per 8x8 tile. a tile sees
+// clouds if the ray of any of its pixels
+// crosses the cloud volume.
+void main() {
+	if (gl_LocalInvocationIndex == 0) {
+		tile_hit = 0;
+	}
+	barrier();
+
+	vec2 pixel = vec2(gl_GlobalInvocationID.xy) + 0.5 + pixel_offset;
+	if (all(lessThan(pixel, resolution))) {
+		vec3 direction = ray_direction(pixel, resolution);
+		if (ray_to_cloud(camera_location, 1.0 / direction, cloud_location - cloud_volume, cloud_location + cloud_volume).y > 0.0) {
+			atomicOr(tile_hit, 1);
+		}
+	}
+	barrier();
+
+	if (gl_LocalInvocationIndex == 0) {
+		uint tile = gl_WorkGroupID.x | (gl_WorkGroupID.y << 16);
+		if (tile_hit != 0) {
+			tile_list[atomicAdd(cloud_groups[0], 1)] = tile;
+		} else {
+			uint tile_count = gl_NumWorkGroups.x * gl_NumWorkGroups.y;
+			tile_list[tile_count - 1 - atomicAdd(sky_groups[0], 1)] = tile;
+		}
+	}
+}
@@ -0,0 +1,20 @@
+#version 430
+layout(local_size_x = 8, local_size_y = 8) in;
+layout(rg32f, location = 0) uniform writeonly image2D output_texture;
+
+#include "atmosphere.glsl"
+
+// optical depth to the top of the atmosphere
+// for every height and zenith angle. doesn't
+// depend on anything but the planet, so it's
+// baked once.
+void main() {
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(output_texture);
+	if (any(greaterThanEqual(texel, size))) return;
+	float h, mu;
+	transmittance_parameters((vec2(texel) + 0.5) / vec2(size), h, mu);
+	vec3 point = earth_center + vec3(0.0, radius_surface + h, 0.0);
+	vec3 direction = vec3(sqrt(max(0.0, 1.0 - mu * mu)), mu, 0.0);
+	imageStore(output_texture, texel, vec4(atmosphere_light_depth(point, direction), 0.0, 0.0));
+}
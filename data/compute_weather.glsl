@@ -2,19 +2,6 @@
 layout(local_size_x = 8, local_size_y = 8) in;
 layout(r8, location = 0) uniform image2D output_texture;
 
-// point grid buffers (SSBOs)
-layout(std430, binding = 1) buffer points_a {
-	vec4 p_a[];
-};
-
-layout(std430, binding = 2) buffer points_b {
-	vec4 p_b[];
-};
-
-layout(std430, binding = 3) buffer points_c {
-	vec4 p_c[];
-};
-
 // ---- vars ---- //
 // per axis resolution of the texture
 uniform int resolution;
@@ -25,6 +12,21 @@ uniform float persistance;
 uniform int subdivisions_a;
 uniform int subdivisions_b;
 uniform int subdivisions_c;
+// feature points are hashed from their cell
+// and the seed.
+// clipmap mode.
+// output_texture is one level of the clipmap
+// and a rectangle of it is baked. weather
+// doesn't repeat: cells aren't wrapped.
+uniform int clipmap;
+uniform ivec2 clipmap_origin; // first texel
+uniform ivec2 clipmap_size; // texels
+uniform float clipmap_texel_size; // weather units
+uniform int seed;
+// first row of a time sliced bake
+uniform int slice_offset;
+
+#include "hash.glsl"
 
 const ivec2 offsets[9] = ivec2[9](
 	// centre
@@ -40,53 +42,57 @@ const ivec2 offsets[9] = ivec2[9](
 	ivec2(1,-1)
 );
 
-// computes a layer of the noise
-float compute_worley_layer(vec2 pos, int sub, int point_grid_index) {
+// computes a layer of the noise. points are
+// hashed from their cell, cells past the
+// border from the cell they wrap to, so the
+// map repeats seamlessly
+float compute_worley_layer(vec2 pos, int sub, int layer) {
 	ivec2 cell_id = ivec2(floor(pos * sub));
 	float min_dist = 1.0;
 	for (int offset_index = 0; offset_index < 9; ++offset_index) {
 		ivec2 adj_id = cell_id + offsets[offset_index];
-		// if adj cell is outside, blend texture to it ->
-		// repeat seemlessly
-		if (min(adj_id.x, adj_id.y) == -1 || max(adj_id.x, adj_id.y) == sub) {
-			ivec2 wrapped_id = ivec2(mod(adj_id + ivec2(sub), vec2(sub)));
-			// get index
-			int adj_index = wrapped_id.x + sub * wrapped_id.y;
-			vec2 wrapped_point;
-			if (point_grid_index == 0) {
-				wrapped_point = p_a[adj_index].xy;
-			} else if (point_grid_index == 1) {
-				wrapped_point = p_b[adj_index].xy;
-			} else {
-				wrapped_point = p_c[adj_index].xy;
-			}
-			for (int wrapped_offset_index = 0; wrapped_offset_index < 9; ++wrapped_offset_index) {
-				vec2 difference = (pos - (wrapped_point + vec2(offsets[wrapped_offset_index])));
-				min_dist = min(min_dist, dot(difference, difference));
-			}
-		} else {
-			// adj cell is inside known map
-			// calc distance from position to cell point
-			int adj_index = adj_id.x + sub * adj_id.y;
-			vec2 difference = pos;
-			if (point_grid_index == 0) {
-				difference -= p_a[adj_index].xy;
-			} else if (point_grid_index == 1) {
-				difference -= p_b[adj_index].xy;
-			} else {
-				difference -= p_c[adj_index].xy;
-			}
-			min_dist = min(min_dist, dot(difference, difference));
-		}
+		ivec2 wrapped_id = (adj_id + sub) % sub;
+		vec2 difference = pos - (vec2(adj_id) + hash_point(wrapped_id, seed, layer)) / sub;
+		min_dist = min(min_dist, dot(difference, difference));
+	}
+	return sqrt(min_dist);
+}
+
+// same as above over an endless plane
+float compute_worley_layer_unbounded(vec2 pos, int sub, int layer) {
+	vec2 cell_pos = pos * sub;
+	ivec2 cell_id = ivec2(floor(cell_pos));
+	float min_dist = 1.0;
+	for (int offset_index = 0; offset_index < 9; ++offset_index) {
+		ivec2 adj_id = cell_id + offsets[offset_index];
+		vec2 difference = (cell_pos - (vec2(adj_id) + hash_point(adj_id, seed, layer))) / sub;
+		min_dist = min(min_dist, dot(difference, difference));
 	}
 	return sqrt(min_dist);
 }
 
 void main() {
-	vec2 position = vec2(gl_GlobalInvocationID) / resolution;
-	float layer_a = compute_worley_layer(position, subdivisions_a, 0);
-	float layer_b = compute_worley_layer(position, subdivisions_b, 1);
-	float layer_c = compute_worley_layer(position, subdivisions_c, 2);
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	vec2 position = vec2(texel) / resolution;
+	float layer_a, layer_b, layer_c;
+	if (clipmap == 1) {
+		if (any(greaterThanEqual(texel, clipmap_size))) return;
+		// the level is addressed toroidally: each
+		// texel of the plane has a fixed place in
+		// the texture, wherever the clipmap is.
+		texel += clipmap_origin;
+		position = (vec2(texel) + 0.5) * clipmap_texel_size;
+		texel = ivec2(mod(vec2(texel), vec2(resolution)));
+		layer_a = compute_worley_layer_unbounded(position, subdivisions_a, 0);
+		layer_b = compute_worley_layer_unbounded(position, subdivisions_b, 1);
+		layer_c = compute_worley_layer_unbounded(position, subdivisions_c, 2);
+	} else {
+		texel.y += slice_offset;
+		position = vec2(texel) / resolution;
+		layer_a = compute_worley_layer(position, subdivisions_a, 0);
+		layer_b = compute_worley_layer(position, subdivisions_b, 1);
+		layer_c = compute_worley_layer(position, subdivisions_c, 2);
+	}
 	// combine layers
 	float noise_sum = layer_a + (layer_b * persistance) + (layer_c * persistance * persistance);
 	// map to 0.0 - 1.0
@@ -96,5 +102,5 @@ void main() {
 	// accentuate dark tones
 	noise_sum = pow(noise_sum, 4); // noise^4
 	// write to texture
-	imageStore(output_texture, ivec2(gl_GlobalInvocationID), vec4(noise_sum));
+	imageStore(output_texture, texel, vec4(noise_sum));
 }
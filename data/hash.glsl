@@ -0,0 +1,49 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+// integer hashes for feature points. every
+// point comes from its cell, seed and layer,
+// nothing is laid out beforehand. noise_baker
+// hashes the same way on the cpu.
+// https://www.jcgt.org/published/0009/03/02/
+
+uvec3 pcg3d(uvec3 v) {
+	v = v * 1664525u + 1013904223u;
+	v.x += v.y * v.z;
+	v.y += v.z * v.x;
+	v.z += v.x * v.y;
+	v ^= v >> 16u;
+	v.x += v.y * v.z;
+	v.y += v.z * v.x;
+	v.z += v.x * v.y;
+	return v;
+}
+
+uvec4 pcg4d(uvec4 v) {
+	v = v * 1664525u + 1013904223u;
+	v.x += v.y * v.w;
+	v.y += v.z * v.x;
+	v.z += v.x * v.y;
+	v.w += v.y * v.z;
+	v ^= v >> 16u;
+	v.x += v.y * v.w;
+	v.y += v.z * v.x;
+	v.z += v.x * v.y;
+	v.w += v.y * v.z;
+	return v;
+}
+
+// random point in [0, 1)^2 for a 2d cell,
+// different for every seed and layer
+vec2 hash_point(ivec2 cell, int seed, int layer) {
+	uvec3 h = pcg3d(uvec3(uvec2(cell), uint(seed) * 8u + uint(layer)));
+	return vec2(h.xy) * (1.0 / 4294967296.0);
+}
+
+// same for a 3d cell
+vec3 hash_point(ivec3 cell, int seed, int layer) {
+	uvec4 h = pcg4d(uvec4(uvec3(cell), uint(seed) * 8u + uint(layer)));
+	return vec3(h.xyz) * (1.0 / 4294967296.0);
+}
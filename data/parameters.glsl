@@ -0,0 +1,68 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+// render, cloud, noise, wind and skydome
+// parameters. uploaded once per frame, and
+// only when they change, by the application.
+// mirrored by struct parameters in
+// src/parameters.h -> keep both in sync.
+// every vec3 is followed by a scalar that
+// fills the rest of its 16 bytes.
+layout(std140, binding = 0) uniform parameters {
+	// light
+	vec3 light_direction;
+	float cloud_absorption;
+	vec3 inverse_light_direction;
+	float cloud_density_threshold;
+
+	// cloud
+	vec3 cloud_location;
+	float cloud_density_multiplier;
+	vec3 cloud_volume;
+	float cloud_volume_edge_fade_distance;
+
+	// noise
+	vec3 noise_main_offset;
+	float noise_main_scale;
+	vec3 noise_detail_offset;
+	float noise_detail_scale;
+	vec2 noise_weather_offset;
+	float noise_weather_scale;
+	float noise_detail_weight;
+
+	// wind
+	vec3 wind_vector;
+	float wind_main_weight;
+	float wind_weather_weight;
+	float wind_detail_weight;
+
+	// skydome. starts a new 16 bytes, and
+	// render_volume_samples fills its last 4
+	vec3 background_color;
+
+	// render
+	int render_volume_samples;
+	int render_adaptive_steps;
+	float render_step_min;
+	float render_step_max;
+	int render_in_scatter_samples;
+	float render_shadowing_max_distance;
+	float render_shadowing_weight;
+	int render_empty_space_skipping;
+	int render_noise_lod;
+	int render_light_volume;
+	int render_temporal;
+	int render_sky;
+	int render_sky_lut;
+
+	// noise modes
+	int noise_packed;
+	// weather clipmap centred on the camera.
+	// level n is 2^n times as wide as level 0.
+	int noise_weather_clipmap;
+	int noise_weather_clipmap_levels;
+	float noise_weather_clipmap_texel_size; // level 0, weather units
+	ivec2 noise_weather_clipmap_centers[8]; // texel at the centre of each level
+};
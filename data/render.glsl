@@ -0,0 +1,386 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+// everything that colors a pixel: clouds,
+// sky and the passes that split them. shared
+// by the fullscreen quad and the tiled
+// compute renderer.
+
+#include "atmosphere.glsl"
+#include "clouds.glsl"
+#include "camera.glsl"
+
+// ---------------------------- //
+// -------- parameters -------- //
+// ---------------------------- //
+
+uniform sampler2D sky_texture;
+uniform float noise_depth;
+uniform float noise_zoom;
+uniform vec2 resolution;
+uniform vec3 box_size;
+uniform vec3 light_color;
+uniform vec3 light_mask = vec3(1.0, 0.98, 0.96);
+
+// render
+uniform sampler3D light_volume_texture;
+
+// passes
+// 0 -> sky and clouds at once
+// 1 -> clouds only. color + transmittance
+// 2 -> sky composited with upsampled clouds
+uniform int render_pass;
+uniform vec2 cloud_resolution;
+uniform sampler2D cloud_texture;
+
+// temporal
+uniform float render_temporal_blend;
+uniform vec3 previous_camera_location;
+uniform mat4 previous_view_matrix;
+// animation_time minus the last frame's
+uniform float animation_time_step;
+uniform sampler2D history_texture;
+
+float remap(float value, float old_low, float old_high, float new_low, float new_high) {
+	return new_low + (value - old_low) * (new_high - new_low) / (old_high - old_low);
+}
+
+// ---- clouds ---- declarations ---- //
+float phase(float x);
+float mie_in_scatter(vec3 position, float footprint);
+vec4 cloud_march(vec3 direction, vec2 pixel);
+vec4 cloud_march_adaptive(vec3 direction, vec2 pixel);
+vec4 cloud_upsample(vec2 pixel, vec3 direction);
+// ------------------------------- //
+
+// ---- temporal ---- declarations ---- //
+float interleaved_gradient_noise(vec2 pixel);
+vec2 reproject(vec3 direction);
+vec4 temporal_blend(vec4 cloud, vec3 direction, float depth);
+// ------------------------------- //
+
+// sky seen along a direction
+vec3 sky_color(vec3 direction) {
+	if (render_sky == 1 && render_sky_lut == 1) {
+		return texture(sky_texture, sky_view_uv(direction)).rgb;
+	} else if (render_sky == 1) {
+		float l = atmosphere_march(camera_location, direction, radius_atmosphere);
+		return atmosphere_scatter(camera_location, direction, l, light_direction);
+	}
+	return background_color;
+}
+
+// color of a pixel for the current pass
+vec4 render_pixel(vec2 pixel) {
+
+	// ---- ray direction ---- // 
+
+	vec3 dir = ray_direction(pixel, resolution);
+
+	// ---- mie ---- //
+
+	// rgb -> accumulated light
+	// a   -> transmittance
+	vec4 cloud;
+	if (render_pass == 2) {
+		cloud = cloud_upsample(pixel, dir);
+	} else {
+		cloud = cloud_march(dir, pixel);
+	}
+
+	if (render_pass == 1) {
+		return cloud;
+	}
+
+	// ---- rayleigh ---- //
+
+	return vec4((sky_color(dir) * cloud.a) + cloud.rgb, 1.0);
+}
+
+// same as render_pixel for pixels whose ray
+// misses the cloud volume
+vec4 render_sky_pixel(vec2 pixel) {
+	if (render_pass == 1) {
+		return vec4(0.0, 0.0, 0.0, 1.0);
+	}
+	return vec4(sky_color(ray_direction(pixel, resolution)), 1.0);
+}
+
+// --------------------- //
+// -------- mie -------- //
+// --------------------- //
+
+// amount of light reaching a point in the
+// volume, either fetched from the light
+// volume or marched toward the light
+float mie_in_scatter(vec3 position, float footprint) {
+	float total_density;
+	if (render_light_volume == 1) {
+		vec3 lower_bound = cloud_location - cloud_volume;
+		total_density = texture(light_volume_texture, (position - lower_bound) / (2.0 * cloud_volume)).r;
+	} else {
+		total_density = mie_light_depth(position, footprint);
+	}
+	return (1.0 - render_shadowing_weight) + exp(-total_density * cloud_absorption) * render_shadowing_weight;
+}
+
+// marches the cloud volume along a ray.
+// returns accumulated light and transmittance
+vec4 cloud_march(vec3 direction, vec2 pixel) {
+	if (render_adaptive_steps == 1) {
+		return cloud_march_adaptive(direction, pixel);
+	}
+
+	float radiance = 1.0; // transparent
+	vec3 color_cloud = vec3(0.0); // accumulated light
+	
+	vec2 march = ray_to_cloud(camera_location, 1.0 / direction, cloud_location - cloud_volume, cloud_location + cloud_volume);
+	float distance_per_step = march.y / render_volume_samples;
+	float distance_travelled = 0.0;
+
+	// when rendering temporally, every frame
+	// starts the ray at a different fraction
+	// of a step. accumulating the history
+	// then integrates the whole step.
+	if (render_temporal == 1) {
+		distance_travelled = fract(interleaved_gradient_noise(pixel) + float(frame) * 0.61803398875) * distance_per_step;
+	}
+
+	// light-weighted depth of the cloud along
+	// this ray. used to reproject it.
+	float depth_sum = 0.0;
+	float depth_weight = 0.0;
+
+	// henyey greenstein phase function
+	// value for this ray's direction.
+	// -> provides silver lining when
+	//    looking towards sun.
+
+	float hg_constant = henyey_greenstein(0.2, dot(direction, light_direction));
+
+	// if ray hits cloud, compute amount of
+	// light that reaches the cloud's surface
+
+	for (; distance_travelled < march.y; distance_travelled += distance_per_step) {
+		vec3 ray_position = camera_location + direction * (march.x + distance_travelled);
+		// leap over cells known to be empty,
+		// landing back on this ray's step grid.
+		if (render_empty_space_skipping == 1) {
+			float empty = cloud_empty_distance(ray_position, direction, march.y - distance_travelled);
+			if (empty > 0.0) {
+				distance_travelled += floor(empty / distance_per_step) * distance_per_step;
+				continue;
+			}
+		}
+		// sample noise density at current
+		// ray position.
+		float footprint = (march.x + distance_travelled) / resolution.y;
+		float density = mie_density(ray_position, footprint);
+		// extinguish radiance using
+		// beer's law -> (e^(-d*deltaX)).
+		radiance *= exp(-density * distance_per_step);
+		// avoid doing extra loops if it's
+		// already dark.
+		if (radiance < 0.01) break;
+		// amount of light in-scattered to 
+		// this point in the cloud;
+		// extinction coefficient when going
+		// through the volume toward the sun.
+		float in_light = mie_in_scatter(ray_position, footprint);
+		// add to cloud's surface color
+		color_cloud += density * distance_per_step * in_light * radiance * hg_constant;
+		depth_sum += (march.x + distance_travelled) * density * radiance;
+		depth_weight += density * radiance;
+	}
+
+	float depth = depth_weight > 0.0 ? depth_sum / depth_weight : 0.0;
+	return temporal_blend(vec4(color_cloud, radiance), direction, depth);
+}
+
+// marches the cloud volume with steps that
+// adapt to it:
+// -> long steps through clear air, checking
+//    only the weather coverage
+// -> back one step and short steps once
+//    there may be cloud
+// -> steps grow back as transmittance falls
+//    and what's left contributes less
+vec4 cloud_march_adaptive(vec3 direction, vec2 pixel) {
+	float radiance = 1.0; // transparent
+	vec3 color_cloud = vec3(0.0); // accumulated light
+
+	vec2 march = ray_to_cloud(camera_location, 1.0 / direction, cloud_location - cloud_volume, cloud_location + cloud_volume);
+	float distance_travelled = 0.0;
+	if (render_temporal == 1) {
+		distance_travelled = fract(interleaved_gradient_noise(pixel) + float(frame) * 0.61803398875) * render_step_max;
+	}
+
+	float depth_sum = 0.0;
+	float depth_weight = 0.0;
+	float hg_constant = henyey_greenstein(0.2, dot(direction, light_direction));
+
+	// fine steps are kept at least up to the
+	// coarse step that found coverage
+	bool fine = false;
+	float fine_until = 0.0;
+	// enough iterations for fine steps all the
+	// way, plus coarse ones and their step back.
+	// clamped to bound a frame's cost: past
+	// 4096 the ray ends early.
+	int max_steps = int(clamp(march.y / render_step_min + 2.0 * march.y / render_step_max + 16.0, 64.0, 4096.0));
+	for (int i = 0; i < max_steps && distance_travelled < march.y; ++i) {
+		vec3 ray_position = camera_location + direction * (march.x + distance_travelled);
+		if (render_empty_space_skipping == 1) {
+			float empty = cloud_empty_distance(ray_position, direction, march.y - distance_travelled);
+			if (empty > 0.0) {
+				distance_travelled += empty;
+				fine = false;
+				continue;
+			}
+		}
+		bool covered = mie_coverage(ray_position) > cloud_density_threshold;
+		if (!fine) {
+			if (covered) {
+				// cloud may have started anywhere
+				// since the last coarse step
+				fine = true;
+				fine_until = distance_travelled;
+				distance_travelled = max(distance_travelled - render_step_max, 0.0);
+			} else {
+				distance_travelled += render_step_max;
+			}
+			continue;
+		}
+		if (!covered) {
+			fine = distance_travelled < fine_until;
+			distance_travelled += render_step_min;
+			continue;
+		}
+		float step_size = clamp(render_step_min / radiance, render_step_min, render_step_max);
+		float footprint = (march.x + distance_travelled) / resolution.y;
+		float density = mie_density(ray_position, footprint);
+		radiance *= exp(-density * step_size);
+		if (radiance < 0.01) break;
+		float in_light = mie_in_scatter(ray_position, footprint);
+		color_cloud += density * step_size * in_light * radiance * hg_constant;
+		depth_sum += (march.x + distance_travelled) * density * radiance;
+		depth_weight += density * radiance;
+		distance_travelled += step_size;
+	}
+
+	float depth = depth_weight > 0.0 ? depth_sum / depth_weight : 0.0;
+	return temporal_blend(vec4(color_cloud, radiance), direction, depth);
+}
+
+// blends a freshly marched cloud sample
+// with the previous frames' reprojected one.
+// depth is zero if the ray hit no cloud.
+vec4 temporal_blend(vec4 cloud, vec3 direction, float depth) {
+	if (render_temporal == 1 && render_temporal_blend > 0.0) {
+		// sky pixels are reprojected by direction
+		// only. cloud pixels are reprojected
+		// through their average depth and moved
+		// along with the weather map, which is
+		// the layer that decides where clouds are.
+		vec3 weather_motion = vec3(wind_vector.x, 0.0, wind_vector.z) * wind_weather_weight * noise_weather_scale * animation_time_step;
+		vec3 previous_direction = direction;
+		if (depth > 0.0) {
+			vec3 previous_position = camera_location + direction * depth + weather_motion;
+			previous_direction = normalize(previous_position - previous_camera_location);
+		}
+		vec2 history_uv = reproject(previous_direction);
+		float weight = render_temporal_blend;
+		// the reprojected point left the screen
+		if (any(lessThan(history_uv, vec2(0.0))) || any(greaterThan(history_uv, vec2(1.0)))) {
+			weight = 0.0;
+		}
+		// the main and detail layers drift apart
+		// from the weather map with the wind, which
+		// reprojection can't follow. drop history
+		// once that drift covers a pixel.
+		if (depth > 0.0) {
+			vec3 main_motion = wind_vector * wind_main_weight * noise_main_scale * animation_time_step;
+			vec3 detail_motion = wind_vector * wind_detail_weight * noise_detail_scale * animation_time_step;
+			float drift = max(length(main_motion - weather_motion), length(detail_motion - weather_motion));
+			float drift_pixels = drift * resolution.y / depth;
+			weight *= clamp(1.5 - drift_pixels, 0.0, 1.0);
+		}
+		vec4 history = texture(history_texture, history_uv);
+		// history that doesn't agree with this
+		// frame's coverage belongs to something
+		// else -> disocclusion.
+		weight *= clamp(1.0 - (abs(history.a - cloud.a) - 0.1) * 4.0, 0.0, 1.0);
+		cloud = mix(cloud, history, weight);
+	}
+	return cloud;
+}
+
+// upsamples the reduced resolution cloud
+// pass. bilinear weights are pulled toward
+// the transmittance the neighbourhood agrees
+// on, so silhouettes don't get blurred, and
+// low resolution texels whose ray saw the
+// volume differently than this pixel's are
+// rejected.
+vec4 cloud_upsample(vec2 pixel, vec3 direction) {
+	vec3 lower_bound = cloud_location - cloud_volume;
+	vec3 upper_bound = cloud_location + cloud_volume;
+	bool hit = ray_to_cloud(camera_location, 1.0 / direction, lower_bound, upper_bound).y > 0.0;
+	if (!hit) {
+		return vec4(0.0, 0.0, 0.0, 1.0);
+	}
+
+	vec2 position = pixel * cloud_resolution / resolution - 0.5;
+	ivec2 base = ivec2(floor(position));
+	vec2 f = position - vec2(base);
+	ivec2 texel_max = ivec2(cloud_resolution) - 1;
+
+	vec4 samples[4];
+	float weights[4];
+	float transmittance = 0.0;
+	for (int i = 0; i < 4; ++i) {
+		ivec2 offset = ivec2(i & 1, i >> 1);
+		ivec2 texel = clamp(base + offset, ivec2(0), texel_max);
+		samples[i] = texelFetch(cloud_texture, texel, 0);
+		vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+		weights[i] = bilinear.x * bilinear.y;
+		// does this texel's own ray cross the volume?
+		vec3 texel_direction = ray_direction(vec2(texel) + 0.5, cloud_resolution);
+		if (ray_to_cloud(camera_location, 1.0 / texel_direction, lower_bound, upper_bound).y <= 0.0) {
+			weights[i] *= 0.001;
+		}
+		transmittance += samples[i].a * weights[i];
+	}
+
+	vec4 cloud = vec4(0.0);
+	float weight_sum = 0.0;
+	for (int i = 0; i < 4; ++i) {
+		float w = weights[i] / (0.05 + abs(samples[i].a - transmittance));
+		cloud += samples[i] * w;
+		weight_sum += w;
+	}
+	return cloud / weight_sum;
+}
+
+// -------------------------- //
+// -------- temporal -------- //
+// -------------------------- //
+
+// per pixel offset that's stable in time
+// http://www.iryoku.com/next-generation-post-processing-in-call-of-duty-advanced-warfare
+float interleaved_gradient_noise(vec2 pixel) {
+	return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+}
+
+// screen coordinates [0, 1] at which the
+// previous frame's camera saw this direction
+vec2 reproject(vec3 direction) {
+	// view matrices only rotate
+	vec3 view_direction = transpose(mat3(previous_view_matrix)) * direction;
+	if (view_direction.z >= 0.0) return vec2(-1.0);
+	vec2 uv = view_direction.xy * (-2.0 / view_direction.z);
+	uv.x /= resolution.x / resolution.y;
+	return uv * 0.5 + 0.5;
+}
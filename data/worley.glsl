@@ -0,0 +1,50 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+// tileable 3d worley noise layers. a layer is
+// a grid of sub^3 cells with a point each,
+// hashed from the cell, seed and layer. cells
+// past the border hash the cell they wrap to
+// and keep their own place, so the texture
+// repeats with no special case.
+
+#include "hash.glsl"
+
+// point of a cell in texture space. cells may
+// be one past the border, no further: % of a
+// negative int is undefined in glsl
+vec3 worley_point(ivec3 cell_id, int sub, int seed, int layer) {
+	ivec3 wrapped_id = (cell_id + sub) % sub;
+	return (vec3(cell_id) + hash_point(wrapped_id, seed, layer)) / sub;
+}
+
+// computes a layer of the noise
+float compute_worley_layer(vec3 pos, int sub, int seed, int layer) {
+	ivec3 cell_id = ivec3(floor(pos * sub));
+	float min_dist = 1.0;
+	for (int z = -1; z <= 1; ++z) {
+		for (int y = -1; y <= 1; ++y) {
+			for (int x = -1; x <= 1; ++x) {
+				vec3 difference = pos - worley_point(cell_id + ivec3(x, y, z), sub, seed, layer);
+				min_dist = min(min_dist, dot(difference, difference));
+			}
+		}
+	}
+	return sqrt(min_dist);
+}
+
+// fbm out of three layers. inverted, so
+// that cell centres are bright.
+float combine_worley_layers(float layer_a, float layer_b, float layer_c, float persistance) {
+	// combine layers
+	float noise_sum = layer_a + (layer_b * persistance) + (layer_c * persistance * persistance);
+	// map to 0.0 - 1.0
+	noise_sum /= (1.0 + persistance + (persistance * persistance));
+	// invert
+	noise_sum = 1.0 - noise_sum;
+	// accentuate dark tones
+	noise_sum = noise_sum * noise_sum * noise_sum * noise_sum; // noise^4
+	return noise_sum;
+}
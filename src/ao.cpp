@@ -16,6 +16,9 @@
 #include <cstdio>
 #include <vector>
 #include <map>
+#include <deque>
+#include <algorithm>
+#include <cstring>
 
 #include <opencv2/videoio.hpp>
 #include <opencv2/imgcodecs.hpp>
@@ -32,21 +35,106 @@
 #include "imgui_impl_glfw.h"
 
 #include "shader.h"
-
-#include "program_data.h"
+#include "framebuffer.h"
+#include "parameters.h"
+#include "headless.h"
+#include "readback.h"
+#include "encoder.h"
+#include "image_writer.h"
+#include "profiler.h"
+#include "bench.h"
+#include "cpu_renderer.h"
+#include "noise_baker.h"
+#include "noise_cache.h"
+#include "bake_job.h"
 
 #define IMGUI_IMPL_OPENGL_LOADER_GLEW
 
 // -------- h e l p e r s -------- //
 
-static void write_pixels_to_mat(cv::Mat& ref, int width, int height);
+static void pixels_to_mat(const unsigned char* pixels, cv::Mat& ref, int width, int height);
+// level 0 of a baked r8 noise texture
+static void read_noise_texture(unsigned int texture_id, int resolution, bool volume, cpu_renderer::noise_texture& noise);
 static void imgui_help_marker(const char* desc, bool warning = false);
 
+// -------- l i g h t -------- //
+
+// light's angle at a time of the day.
+// sunrise - 6:00am, sunset - 6:00pm
+static void light_direction_from_time(float time, float* direction);
+// unit length direction and its inverse
+static void light_direction_normalize(float* direction, float* inverse);
+
+// -------- c o m m a n d   l i n e -------- //
+
+struct options {
+	bool headless = false;
+	int preset = 0;
+	float camera_location[3] = { 0.0f, 0.0f, 0.0f };
+	float camera_pitch = 90.0f;
+	float camera_yaw = 0.0f;
+	float time = 15.0f;
+	int resolution[2] = { 1280, 720 };
+	int frames = 1;
+	std::string output = "ao_image.png";
+	// offline sequence. off while fps is 0
+	float sequence_start = 0.0f;
+	float sequence_duration = 0.0f;
+	int sequence_fps = 0;
+	// tile size of a tiled still. off while 0
+	int tiles = 0;
+	// chrome trace of the whole run, if set
+	std::string trace;
+	// benchmark results file, if set
+	std::string bench;
+	// still rendered by the cpu renderer
+	bool cpu = false;
+	// its threads. 0 -> one per core
+	int threads = 0;
+	// seed of the noise points and wind. the
+	// same every run, so the cache is hit
+	int seed = 1;
+	// given explicitly, rather than defaults
+	bool resolution_set = false;
+	bool frames_set = false;
+};
+
+// false if the arguments don't make sense
+static bool parse_options(int argc, char* argv[], options& o);
+
+// -------- b e n c h -------- //
+
+// camera paths each preset is benchmarked
+// along: looking up into the volume, at the
+// horizon, from inside it, and from above
+const char* bench_paths[] = { "up", "horizon", "inside", "above" };
+
+// camera at t in [0, 1] along a path
+static void bench_camera(int path, float t, const float* cloud_location, const float* cloud_volume, glm::vec3& location, float& pitch, float& yaw);
+
 // -------- n o i s e -------- //
 
-void bake_noise_main(unsigned int &texture_id, shader* compute, int resolution, float persistance, int subdivisions_a, int subdivisions_b, int subdivisions_c);
+// points are hashed from seed. cache ->
+// loaded from disk when baked before, stored
+// otherwise. cpu -> baked on the cpu and
+// uploaded, same points, same texture.
+// job -> spread over the next frames by it,
+// texture_id is replaced once it's done
+void bake_noise_main(unsigned int &texture_id, shader* compute, int resolution, float persistance, int subdivisions_a, int subdivisions_b, int subdivisions_c, int seed, noise_cache* cache = nullptr, noise_baker* cpu = nullptr, bake_job* job = nullptr);
+
+void bake_noise_weather(unsigned int &texture_id, shader* compute, int resolution, float persistance, int subdivisions_a, int subdivisions_b, int subdivisions_c, int seed, noise_cache* cache = nullptr, noise_baker* cpu = nullptr, bake_job* job = nullptr);
+
+void bake_noise_packed(unsigned int &texture_id, shader* compute, int resolution, int detail_repeat, float main_persistance, int main_subdivisions_a, int main_subdivisions_b, int main_subdivisions_c, float detail_persistance, int detail_subdivisions_a, int detail_subdivisions_b, int detail_subdivisions_c, int main_seed, int detail_seed);
+
+void bake_noise_weather_max(unsigned int &texture_id, unsigned int weather_texture_id, shader* compute, int resolution);
+
+void bake_noise_weather_clipmap(unsigned int &texture_id, shader* compute, int resolution, int levels, float texel_size, int* centers, bool rebake, float center_u, float center_v, int seed, float persistance, int subdivisions_a, int subdivisions_b, int subdivisions_c);
+
+// -------- a t m o s p h e r e -------- //
 
-void bake_noise_weather(unsigned int &texture_id, shader* compute, int resolution, float persistance, int subdivisions_a, int subdivisions_b, int subdivisions_c);
+void bake_atmosphere_transmittance(unsigned int &texture_id, shader* compute);
+
+void bake_atmosphere_sky(unsigned int &texture_id, shader* compute, unsigned int transmittance_texture_id, float* light_direction, glm::vec3 camera_location);
 
 // -------- c l o u d s --------//
 
@@ -233,19 +321,44 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos);
 
 int main(int argc, char* argv[]) {
 
+	// ---- command line ---- //
+
+	options launch;
+	if (!parse_options(argc, argv, launch)) {
+		return 1;
+	}
+	bool headless = launch.headless;
+	bool sequence = launch.sequence_fps > 0;
+	unsigned long long sequence_frames = (unsigned long long)std::round(launch.sequence_duration * launch.sequence_fps);
+
 	// ---- init ao data ---- //
 
 	bool run = 1;
 	bool fullscreen = 0;
-	int resolution[2] = { 1280, 720 };
+	int resolution[2] = { launch.resolution[0], launch.resolution[1] };
+	// tiled stills render at --resolution a tile
+	// at a time. the frame itself is one tile.
+	if (launch.tiles > 0) {
+		resolution[0] = std::min(resolution[0], launch.tiles);
+		resolution[1] = std::min(resolution[1], launch.tiles);
+	}
 	float cursor_sensitivity = 5.0f;
 	unsigned int vao;
 	unsigned int vbo;
 	shader* compute_shader_main;
 	shader* compute_shader_weather;
+	shader* compute_shader_packed;
 	shader* compute_shader_cirro;
+	shader* compute_shader_max_mip;
+	shader* compute_shader_occupancy;
+	shader* compute_shader_transmittance;
+	shader* compute_shader_sky;
+	shader* compute_shader_light_volume;
+	shader* compute_shader_tiles = nullptr;
+	shader* compute_shader_render_clouds = nullptr;
+	shader* compute_shader_render_sky = nullptr;
 	shader* main_shader;
-	GLFWwindow* window;
+	GLFWwindow* window = nullptr;
 	// clouds
 	float cloud_absorption;
 	float cloud_density_threshold;
@@ -269,6 +382,15 @@ int main(int argc, char* argv[]) {
 	float noise_weather_persistence;
 	float noise_weather_scale;
 	float noise_weather_offset[2] = { 0.0f, 0.0f };
+	// weather clipmap. levels of the same size
+	// around the camera, each twice as wide as
+	// the one before. texels are as wide as the
+	// weather texture's at the first level.
+	bool noise_weather_clipmap = 0;
+	bool noise_weather_clipmap_dirty = 1;
+	int noise_weather_clipmap_resolution = 512;
+	int noise_weather_clipmap_levels = 7; // up to 8
+	int noise_weather_clipmap_centers[2 * 8];
 	// noise - detail
 	int noise_detail_resolution = 128;
 	int noise_detail_subdivisions_a;
@@ -278,11 +400,27 @@ int main(int argc, char* argv[]) {
 	float noise_detail_scale;
 	float noise_detail_weight;
 	float noise_detail_offset[3] = { 0.0f, 0.0f, 0.0f };
-
-	// load model
-	{
-		int load = 0;
-		cloud model = clouds[load];
+	// worley noise baked on the cpu, for gpus
+	// without compute or to check them against
+	bool noise_cpu = launch.cpu;
+	noise_baker noise_cpu_baker(launch.threads);
+	// noise points are hashed from the seed,
+	// main, weather and detail one apart. bakes
+	// of the same seed and settings are kept in
+	// ./cache/. benchmarks time the bakes
+	// themselves.
+	int noise_seed = launch.seed;
+	bool noise_cached = launch.bench.empty();
+	noise_cache noise_disk_cache;
+	// noise - packed
+	bool noise_packed = 0;
+	bool noise_packed_dirty = 1;
+	int noise_packed_detail_repeat = 0;
+
+	// preset's values, noise isn't rebaked
+	auto apply_cloud_model = [&](int n) {
+		cloud_model_current = cloud_models[n];
+		cloud model = clouds[n];
 		cloud_absorption = model.cloud_absorption;
 		cloud_density_threshold = model.cloud_density_threshold;
 		cloud_density_multiplier = model.cloud_density_multiplier;
@@ -306,12 +444,13 @@ int main(int argc, char* argv[]) {
 		noise_detail_persistence = model.noise_detail_persistence;
 		noise_detail_scale = model.noise_detail_scale;
 		noise_detail_weight = model.noise_detail_weight;
-	}
+	};
+	apply_cloud_model(launch.preset);
 
 	// wind
 	float wind_direction[3];
 	{
-		srand(time(0));
+		srand(noise_seed);
 		// set random direction
 		float x = (float)rand()/(float)(RAND_MAX);
 		if (rand() % 2 == 0) {
@@ -337,38 +476,73 @@ int main(int argc, char* argv[]) {
 	float wind_detail_weight = 1.0f;
 	// skydome
 	bool render_sky = 1;
+	bool render_sky_lut = 1;
+	bool render_sky_lut_dirty = 1;
+	float render_sky_lut_height = 0.0f;
 	bool light_any_direction = 0;
-	float time = 15.0f; // 6:00am - 18:00pm
+	float time = launch.time; // 6:00am - 18:00pm
 	float light_direction[3];
 	float inverse_light_direction[3];
-	{
-		// set light direction
-		float yz = std::sqrt(2.0f) / 2.0f;
-		light_direction[0] = 0.0f;
-		light_direction[1] = yz;
-		light_direction[2] = yz;
-		inverse_light_direction[0] = 1.0f;
-		inverse_light_direction[1] = 1.0f / light_direction[1];
-		inverse_light_direction[2] = 1.0f / light_direction[2];
-	}
+	light_direction_from_time(time, light_direction);
+	light_direction_normalize(light_direction, inverse_light_direction);
 	float background_color[3] = { 0.0f, 0.0f, 0.0f };
 	// camera
-	glm::vec3 camera_location = glm::vec3(0.0f, 0.0f, 0.0f);
-	glm::mat4 view_matrix = glm::lookAt(camera_location, glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	float camera_pitch = 90.0f;
-	float camera_yaw = 0.0f;
+	glm::vec3 camera_location = glm::vec3(launch.camera_location[0], launch.camera_location[1], launch.camera_location[2]);
+	// only rotates. the location is applied in
+	// the shaders
+	glm::mat4 view_matrix = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	float camera_pitch = launch.camera_pitch;
+	float camera_yaw = launch.camera_yaw;
 	// rendering
 	int fps = 60;
 	int millis_per_frame = 1000 / fps;
 	float last_fps = fps;
 	int render_volume_samples = 32;
+	bool render_adaptive_steps = 0;
+	float render_step_min = 0.5f;
+	float render_step_max = 4.0f;
 	int render_in_scatter_samples = 8;
 	float render_shadowing_max_distance = 8.0f;
 	float render_shadowing_weight = 0.64;
+	// empty space skipping
+	bool render_empty_space_skipping = 1;
+	bool render_noise_lod = 1;
+	int render_occupancy_resolution[3] = { 64, 8, 64 };
+	// light volume
+	bool render_light_volume = 1;
+	bool render_light_volume_dirty = 1;
+	int render_light_volume_resolution[3] = { 128, 16, 128 };
+	int render_light_volume_slices = 16; // z slices refreshed per frame
+	int render_light_volume_slice = 0;
+	std::vector<float> render_light_volume_state;
+	// cloud pass resolution
+	const char* render_cloud_resolutions[] = { "full", "half", "quarter" };
+	const char* render_cloud_resolution = render_cloud_resolutions[0];
+	int render_cloud_divisor = 1;
+	int render_cloud_target_index = 0;
+	framebuffer* render_cloud_targets[2] = { nullptr, nullptr };
+	// tiled compute renderer
+	bool render_tiled = 0;
+	unsigned int render_tiled_buffer = 0;
+	int render_tiled_capacity = 0; // tiles the buffer holds
+	framebuffer* render_tiled_target = nullptr;
+	// temporal
+	bool render_temporal = 0;
+	bool render_temporal_history_valid = 0;
+	float render_temporal_blend = 0.9f;
+	float render_temporal_max_rotation = 2.0f; // degrees per frame
+	float render_temporal_max_translation = 1.0f; // units per frame
+	glm::mat4 previous_view_matrix = view_matrix;
+	glm::vec3 previous_camera_location = camera_location;
+	// windows, sequences and benchmarks each
+	// advance animation_time their own way
+	float previous_animation_time = 0.0f;
 	// export
 	char image_name[32] = "ao_image";
 	const char* image_format = ".png";
 	const char* image_formats[] = { ".png", ".jpg", ".ppm", ".bmp" };
+	int image_tiled_resolution[2] = { 15360, 8640 };
+	int image_tile_size = 1024;
 	bool video = 0;
 	int video_fps = 60;
 	unsigned long long video_start_frame;
@@ -377,68 +551,116 @@ int main(int argc, char* argv[]) {
 	const char* video_formats[] = { ".avi", ".mp4" };
 	cv::VideoWriter video_output;
 	std::chrono::system_clock::time_point video_timer;
-
+	// screen reads finish some frames after
+	// they're requested. each is tagged with
+	// where it goes. image paths are queued in
+	// request order.
+	enum { readback_video, readback_image };
+	pixel_readback* readback = nullptr;
+	std::deque<std::string> readback_images;
+	// and are written out on worker threads.
+	// video frames by a single one, in order.
+	frame_encoder* video_encoder = nullptr;
+	frame_encoder* image_encoder = nullptr;
+
+
+	// ---- init headless ---- //
+
+	// no window: a surfaceless context and a
+	// framebuffer object standing in for the
+	// screen
+	if (headless && !headless_init()) {
+		std::cout << "[-] Headless initialization failed. Exiting ao." << std::endl;
+		return 1;
+	}
 
 	// ---- init glfw ---- //
 
-	if (!glfwInit()) {
+	if (!headless && !glfwInit()) {
 		std::cout << "[-] GLFW initialization failed. Exiting ao." << std::endl;
 		return 1;
 	}
 
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	if (!headless) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-	window = glfwCreateWindow(resolution[0], resolution[1], "glsl", 0, 0);
+		window = glfwCreateWindow(resolution[0], resolution[1], "glsl", 0, 0);
 
-	if (window == NULL) {
-		glfwTerminate();
-		std::cout << "[-] GLFW window initialization failed. Exiting ao." << std::endl;
-		return 1;
-	}
+		if (window == NULL) {
+			glfwTerminate();
+			std::cout << "[-] GLFW window initialization failed. Exiting ao." << std::endl;
+			return 1;
+		}
 
-	glfwMakeContextCurrent(window);
-	glfwSwapInterval(1);
+		glfwMakeContextCurrent(window);
+		// sequences run as fast as they can
+		glfwSwapInterval(sequence ? 0 : 1);
 
-	// set cursor position callback function up
-	glfwSetCursorPosCallback(window, cursor_position_callback);
+		// set cursor position callback function up
+		glfwSetCursorPosCallback(window, cursor_position_callback);
+	}
 	// ---- init glew ---- //
 
-	if (glewInit() != GLEW_OK) {
-		glfwTerminate();
+	// without a window there's no glx display
+	// for glewInit to look at. only the context's
+	// entry points are needed.
+	if ((headless ? glewContextInit() : glewInit()) != GLEW_OK) {
+		if (headless) {
+			headless_terminate();
+		} else {
+			glfwTerminate();
+		}
 		std::cout << "[-] GLEW initialization failed. Exiting ao." << std::endl;
 		return 1;
 	}
 
-	// ---- init shaders ---- //
-	
-	// allocate shader data in memory
-	program_data* data = new program_data();
-
-	// init
-	bool read_shader_from_file = true;
-	if (read_shader_from_file) {
-		compute_shader_main = new shader("./data/compute_main.glsl", true);
-		compute_shader_weather = new shader("./data/compute_weather.glsl", true);
-		main_shader = new shader("./data/vertex.glsl", "./data/fragment.glsl", true);
-	} else {
-		compute_shader_main = new shader(data->compute_main, false);
-		compute_shader_weather = new shader(data->compute_weather, false);
-		main_shader = new shader(data->vertex, data->fragment, false);
+	framebuffer* headless_screen = nullptr;
+	if (headless) {
+		headless_screen = new framebuffer(resolution[0], resolution[1]);
+		framebuffer::screen_id = headless_screen->framebuffer_id;
+		headless_screen->bind();
 	}
 
+	// ---- init shaders ---- //
+
+	// programs come from ./cache/ when they were
+	// built before. otherwise they're compiled
+	// in parallel when the driver can, and each
+	// one is waited for on its first use.
+
+	// init. always read from ./data/, the
+	// #includes are resolved there
+	compute_shader_main = new shader("./data/compute_main.glsl", true);
+	compute_shader_weather = new shader("./data/compute_weather.glsl", true);
+	main_shader = new shader("./data/vertex.glsl", "./data/fragment.glsl", true);
+	// main and detail noise in one texture
+	compute_shader_packed = new shader("./data/compute_packed.glsl", true);
+	// empty space skipping passes
+	compute_shader_max_mip = new shader("./data/compute_max_mip.glsl", true);
+	compute_shader_occupancy = new shader("./data/compute_occupancy.glsl", true);
+	// atmosphere lookup table passes
+	compute_shader_transmittance = new shader("./data/compute_transmittance.glsl", true);
+	compute_shader_sky = new shader("./data/compute_sky.glsl", true);
+	compute_shader_light_volume = new shader("./data/compute_light_volume.glsl", true);
+
 	// set
 	main_shader->bind();
-	main_shader->set3f("light_direction", light_direction[0], light_direction[1], light_direction[2]);
-	main_shader->set3f("inverse_light_direction", inverse_light_direction[0], inverse_light_direction[1], inverse_light_direction[2]);
 	main_shader->set2f("resolution", resolution[0], resolution[1]);
-	main_shader->set1i("render_volume_samples", render_volume_samples);
-	main_shader->set1i("render_in_scatter_samples", render_in_scatter_samples);
 	main_shader->unbind();
 
-	// deallocate shader data from memory
-	delete data;
+	// parameters block shared by the programs
+	// that sample the clouds
+	parameter_buffer* parameter_block = new parameter_buffer(0);
+	parameter_block->check(main_shader);
+	parameter_block->check(compute_shader_light_volume);
+
+	// per pass timings, for the overlay and
+	// trace files
+	profiler* frame_profiler = new profiler();
+	frame_profiler->tracing = !launch.trace.empty();
+	char trace_name[32] = "ao_trace";
 
 	//---- init imgui ----//
 
@@ -447,8 +669,10 @@ int main(int argc, char* argv[]) {
 	ImGuiIO &io = ImGui::GetIO();
 
 	// initialize appropiate bindings
-	ImGui_ImplGlfw_InitForOpenGL(window, true);
-	ImGui_ImplOpenGL3_Init("#version 430");
+	if (!headless) {
+		ImGui_ImplGlfw_InitForOpenGL(window, true);
+		ImGui_ImplOpenGL3_Init("#version 430");
+	}
 
 	// load custom theme
 	ImGuiStyle& style = ImGui::GetStyle();
@@ -545,54 +769,854 @@ int main(int argc, char* argv[]) {
 	// ---- noise ---- //
 	glEnable(GL_TEXTURE_3D);
 
+	frame_profiler->gpu_begin("noise");
+
 	// main
 	unsigned int noise_main_id;
-	bake_noise_main(noise_main_id, compute_shader_main, noise_main_resolution, noise_main_persistence, noise_main_subdivisions_a, noise_main_subdivisions_b, noise_main_subdivisions_c);
+	bake_noise_main(noise_main_id, compute_shader_main, noise_main_resolution, noise_main_persistence, noise_main_subdivisions_a, noise_main_subdivisions_b, noise_main_subdivisions_c, noise_seed, noise_cached ? &noise_disk_cache : nullptr, noise_cpu ? &noise_cpu_baker : nullptr);
 	main_shader->bind();
 	main_shader->set1i("noise_main_texture", noise_main_id);
 	main_shader->unbind();
 
 	// weather
 	unsigned int noise_weather_id;
-	bake_noise_weather(noise_weather_id, compute_shader_weather, noise_weather_resolution, noise_weather_persistence, noise_weather_subdivisions_a, noise_weather_subdivisions_b, noise_weather_subdivisions_c);
+	bake_noise_weather(noise_weather_id, compute_shader_weather, noise_weather_resolution, noise_weather_persistence, noise_weather_subdivisions_a, noise_weather_subdivisions_b, noise_weather_subdivisions_c, noise_seed + 1, noise_cached ? &noise_disk_cache : nullptr, noise_cpu ? &noise_cpu_baker : nullptr);
 	main_shader->bind();
 	main_shader->set1i("noise_weather_texture", noise_weather_id);
 	main_shader->unbind();
 
+	// weather max pyramid
+	unsigned int noise_weather_max_id = 0;
+	bake_noise_weather_max(noise_weather_max_id, noise_weather_id, compute_shader_max_mip, noise_weather_resolution);
+
+	// weather clipmap. baked as the camera moves
+	unsigned int noise_weather_clipmap_id = 0;
+
 	// detail
 	unsigned int noise_detail_id;
-	bake_noise_main(noise_detail_id, compute_shader_main, noise_detail_resolution, noise_detail_persistence, noise_detail_subdivisions_a, noise_detail_subdivisions_b, noise_detail_subdivisions_c);
+	bake_noise_main(noise_detail_id, compute_shader_main, noise_detail_resolution, noise_detail_persistence, noise_detail_subdivisions_a, noise_detail_subdivisions_b, noise_detail_subdivisions_c, noise_seed + 2, noise_cached ? &noise_disk_cache : nullptr, noise_cpu ? &noise_cpu_baker : nullptr);
 	main_shader->bind();
 	main_shader->set1i("noise_detail_texture", noise_detail_id);
 	main_shader->unbind();
 
+	// main and detail packed together. baked
+	// when packed noise is turned on.
+	unsigned int noise_packed_id = 0;
+
+	frame_profiler->gpu_end();
+
+	// ---- empty space ---- //
+
+	// occupancy grid over the cloud volume,
+	// rebuilt every frame from the weather
+	// max pyramid as the wind moves it
+	unsigned int occupancy_id;
+	glGenTextures(1, &occupancy_id);
+	glActiveTexture(GL_TEXTURE0 + occupancy_id);
+	glBindTexture(GL_TEXTURE_3D, occupancy_id);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexStorage3D(GL_TEXTURE_3D, 1, GL_R8, render_occupancy_resolution[0], render_occupancy_resolution[1], render_occupancy_resolution[2]);
+	main_shader->bind();
+	main_shader->set1i("occupancy_texture", occupancy_id);
+	main_shader->unbind();
+
+	// ---- light volume ---- //
+
+	// optical depth toward the light at every
+	// point of the cloud volume, so the main
+	// pass doesn't march toward the light
+	unsigned int light_volume_id;
+	glGenTextures(1, &light_volume_id);
+	glActiveTexture(GL_TEXTURE0 + light_volume_id);
+	glBindTexture(GL_TEXTURE_3D, light_volume_id);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexStorage3D(GL_TEXTURE_3D, 1, GL_R16F, render_light_volume_resolution[0], render_light_volume_resolution[1], render_light_volume_resolution[2]);
+	main_shader->bind();
+	main_shader->set1i("light_volume_texture", light_volume_id);
+	main_shader->unbind();
+
+	// hands finished screen reads to the video
+	// or to their image file. waits for the
+	// first block of them (all if negative),
+	// takes the rest only if they're done.
+	auto consume_readback = [&](int block) {
+		int tag;
+		const unsigned char* data;
+		while (readback && (data = readback->map(block != 0, &tag))) {
+			if (block > 0) --block;
+			frame_encoder* encoder = tag == readback_video ? video_encoder : image_encoder;
+			cv::Mat* pixels = encoder->acquire();
+			pixels_to_mat(data, *pixels, readback->width, readback->height);
+			readback->unmap();
+			if (tag == readback_video) {
+				encoder->submit(pixels, [&](cv::Mat& frame) {
+					video_output << frame;
+				});
+			} else {
+				std::string path = readback_images.front();
+				readback_images.pop_front();
+				encoder->submit(pixels, [path](cv::Mat& frame) {
+					if (!cv::imwrite(path, frame)) {
+						std::cout << "[-] Couldn't write " << path << std::endl;
+					}
+				});
+			}
+		}
+	};
+
+	// queues a read of the screen as it is now
+	auto request_readback = [&](int tag) {
+		if (readback && (readback->width != resolution[0] || readback->height != resolution[1])) {
+			consume_readback(-1);
+			delete readback;
+			delete video_encoder;
+			delete image_encoder;
+			readback = nullptr;
+		}
+		if (readback == nullptr) {
+			readback = new pixel_readback(resolution[0], resolution[1]);
+			video_encoder = new frame_encoder(resolution[0], resolution[1], 6);
+			image_encoder = new frame_encoder(resolution[0], resolution[1], 2);
+		}
+		if (readback->full()) {
+			consume_readback(1);
+		}
+		readback->request(tag);
+	};
+
+	// textures of the cloud density model,
+	// shared by every program that samples it
+	auto set_cloud_textures = [&](shader* program) {
+		program->set1i("occupancy_texture", occupancy_id);
+		program->set1i("noise_main_texture", noise_main_id);
+		program->set1i("noise_weather_texture", noise_weather_id);
+		program->set1i("noise_detail_texture", noise_detail_id);
+		// optional ones only once they exist,
+		// until then they keep their spare unit
+		if (noise_weather_clipmap_id) program->set1i("noise_weather_clipmap_texture", noise_weather_clipmap_id);
+		if (noise_packed_id) program->set1i("noise_packed_texture", noise_packed_id);
+	};
+
+	// draws the main shader's current pass into
+	// target, or to the screen if there's none.
+	// the tiled renderer classifies 8x8 tiles by
+	// whether they see the cloud volume and
+	// renders each kind with its own kernel, so
+	// tiles of sky only don't pay for the
+	// marcher.
+	auto draw_pass = [&](framebuffer* target) {
+		if (!render_tiled) {
+			if (target) target->bind();
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+			if (target) target->unbind();
+			return;
+		}
+		if (compute_shader_tiles == nullptr) {
+			compute_shader_tiles = new shader("./data/compute_tiles.glsl", true);
+			compute_shader_render_clouds = new shader("./data/compute_render.glsl", true);
+			compute_shader_render_sky = new shader("./data/compute_render.glsl", true, "#define SKY_ONLY");
+			glGenBuffers(1, &render_tiled_buffer);
+		}
+		framebuffer* output = target;
+		if (output == nullptr) {
+			if (render_tiled_target == nullptr) {
+				render_tiled_target = new framebuffer(resolution[0], resolution[1]);
+			}
+			output = render_tiled_target;
+		}
+		int tiles_x = (output->width + 7) / 8;
+		int tiles_y = (output->height + 7) / 8;
+		int tile_count = tiles_x * tiles_y;
+
+		// two indirect dispatches with no groups
+		// yet, then the tile list
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, render_tiled_buffer);
+		if (tile_count > render_tiled_capacity) {
+			glBufferData(GL_SHADER_STORAGE_BUFFER, (6 + tile_count) * sizeof(unsigned int), NULL, GL_DYNAMIC_DRAW);
+			render_tiled_capacity = tile_count;
+		}
+		const unsigned int no_groups[6] = { 0, 1, 1, 0, 1, 1 };
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(no_groups), no_groups);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, render_tiled_buffer);
+
+		// classify
+		compute_shader_tiles->bind();
+		compute_shader_tiles->copy_uniforms(main_shader);
+		glDispatchCompute(tiles_x, tiles_y, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+		// render. the kernels see the same
+		// uniforms the quad would.
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, render_tiled_buffer);
+		glBindImageTexture(0, output->texture_ids[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+		shader* kernels[2] = { compute_shader_render_clouds, compute_shader_render_sky };
+		for (int i = 0; i < 2; ++i) {
+			kernels[i]->bind();
+			kernels[i]->copy_uniforms(main_shader);
+			kernels[i]->set1i("output_texture", 0);
+			kernels[i]->set1i("tile_count", tile_count);
+			glDispatchComputeIndirect(i * 3 * sizeof(unsigned int));
+		}
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+		main_shader->bind();
+
+		if (target == nullptr) {
+			output->blit(0, resolution[0], resolution[1]);
+		}
+	};
+
+	// renders a still larger than any framebuffer
+	// a tile at a time. every tile is the same
+	// frame with its pixels offset, so they meet
+	// seamlessly. tiles are read back while the
+	// next ones render and go straight to their
+	// place in the file.
+	auto save_tiled_still = [&](const std::string& path, int width, int height, int tile) {
+		int max_viewport[2];
+		glGetIntegerv(GL_MAX_VIEWPORT_DIMS, max_viewport);
+		tile = std::min(tile, std::min(max_viewport[0], max_viewport[1]));
+		image_writer file;
+		if (!file.open(path, width, height)) {
+			return;
+		}
+		std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+		framebuffer target(tile, tile);
+		pixel_readback tiles(tile, tile, 3, false);
+		int columns = (width + tile - 1) / tile;
+		int rows = (height + tile - 1) / tile;
+		bool written = true;
+		// writes finished tiles, waiting for the
+		// first block of them (all if negative)
+		auto write_tiles = [&](int block) {
+			int index;
+			const unsigned char* pixels;
+			while ((pixels = tiles.map(block != 0, &index))) {
+				if (block > 0) --block;
+				int x = index % columns * tile;
+				int y = index / columns * tile;
+				written &= file.write(pixels, x, y, std::min(tile, width - x), std::min(tile, height - y), tile);
+				tiles.unmap();
+			}
+		};
+		main_shader->bind();
+		main_shader->set1i("render_pass", 0);
+		main_shader->set2f("resolution", width, height);
+		// top row first, the file goes top down
+		for (int row = rows - 1; row >= 0; --row) {
+			for (int column = 0; column < columns; ++column) {
+				main_shader->set2f("pixel_offset", column * tile, row * tile);
+				draw_pass(&target);
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, target.framebuffer_id);
+				if (tiles.full()) {
+					write_tiles(1);
+				}
+				tiles.request(row * columns + column);
+				write_tiles(0);
+			}
+		}
+		write_tiles(-1);
+		main_shader->set2f("resolution", resolution[0], resolution[1]);
+		main_shader->set2f("pixel_offset", 0.0f, 0.0f);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer::screen_id);
+		glViewport(0, 0, resolution[0], resolution[1]);
+		written &= file.close();
+		std::chrono::duration<double> seconds(std::chrono::system_clock::now() - start);
+		if (written) {
+			std::cout << "[+] " << width << "x" << height << " written to " << path << " in " << columns * rows << " tiles, " << seconds.count() << " seconds" << std::endl;
+		} else {
+			std::cout << "[-] Couldn't write " << path << std::endl;
+		}
+	};
+
+	// parameters block contents for this frame
+	auto gather_parameters = [&]() {
+		parameters p;
+		std::memset(&p, 0, sizeof(parameters));
+		// light
+		std::copy(light_direction, light_direction + 3, p.light_direction);
+		std::copy(inverse_light_direction, inverse_light_direction + 3, p.inverse_light_direction);
+		// cloud
+		p.cloud_absorption = cloud_absorption;
+		p.cloud_density_threshold = cloud_density_threshold;
+		p.cloud_density_multiplier = cloud_density_multiplier;
+		p.cloud_volume_edge_fade_distance = cloud_volume_edge_fade_distance;
+		std::copy(cloud_location, cloud_location + 3, p.cloud_location);
+		for (int i = 0; i < 3; ++i) {
+			p.cloud_volume[i] = cloud_volume[i] / 2.0f;
+		}
+		// rendering
+		p.render_volume_samples = render_volume_samples;
+		p.render_adaptive_steps = render_adaptive_steps;
+		p.render_step_min = render_step_min;
+		p.render_step_max = render_step_max;
+		p.render_in_scatter_samples = render_in_scatter_samples;
+		p.render_shadowing_max_distance = render_shadowing_max_distance;
+		p.render_shadowing_weight = render_shadowing_weight;
+		p.render_empty_space_skipping = render_empty_space_skipping && !noise_weather_clipmap;
+		p.render_noise_lod = render_noise_lod;
+		p.render_light_volume = render_light_volume;
+		p.render_temporal = render_temporal;
+		// noise
+		p.noise_main_scale = noise_main_scale;
+		std::copy(noise_main_offset, noise_main_offset + 3, p.noise_main_offset);
+		p.noise_weather_scale = noise_weather_scale;
+		std::copy(noise_weather_offset, noise_weather_offset + 2, p.noise_weather_offset);
+		p.noise_detail_scale = noise_detail_scale;
+		p.noise_detail_weight = noise_detail_weight;
+		std::copy(noise_detail_offset, noise_detail_offset + 3, p.noise_detail_offset);
+		p.noise_packed = noise_packed;
+		p.noise_weather_clipmap = noise_weather_clipmap;
+		p.noise_weather_clipmap_levels = noise_weather_clipmap_levels;
+		p.noise_weather_clipmap_texel_size = 1.0f / noise_weather_resolution;
+		for (int level = 0; level < noise_weather_clipmap_levels; ++level) {
+			p.noise_weather_clipmap_centers[level][0] = noise_weather_clipmap_centers[level * 2];
+			p.noise_weather_clipmap_centers[level][1] = noise_weather_clipmap_centers[level * 2 + 1];
+		}
+		// wind
+		for (int i = 0; i < 3; ++i) {
+			p.wind_vector[i] = wind_direction[i] * wind_speed;
+		}
+		p.wind_main_weight = wind_main_weight;
+		p.wind_weather_weight = wind_weather_weight;
+		p.wind_detail_weight = wind_detail_weight;
+		// skydome
+		p.render_sky = render_sky;
+		p.render_sky_lut = render_sky_lut;
+		std::copy(background_color, background_color + 3, p.background_color);
+		return p;
+	};
+
+
+	// ---- atmosphere ---- //
+
+	// transmittance only depends on the planet.
+	// the sky view is baked on demand.
+	unsigned int atmosphere_transmittance_id = 0;
+	unsigned int atmosphere_sky_id = 0;
+	bake_atmosphere_transmittance(atmosphere_transmittance_id, compute_shader_transmittance);
+
+	// bakes from the window are spread over
+	// frames by these: main, weather and detail.
+	// what each one bakes is kept, a change of
+	// the settings cancels it.
+	bake_job* noise_jobs[3] = { new bake_job(), new bake_job(), new bake_job() };
+	std::vector<float> noise_job_states[3];
+	float noise_job_budget = 2.0f;
+	auto noise_job_state = [&](int n) -> std::vector<float> {
+		switch (n) {
+			case 0: return { (float)noise_main_resolution, noise_main_persistence, (float)noise_main_subdivisions_a, (float)noise_main_subdivisions_b, (float)noise_main_subdivisions_c, (float)noise_seed };
+			case 1: return { (float)noise_weather_resolution, noise_weather_persistence, (float)noise_weather_subdivisions_a, (float)noise_weather_subdivisions_b, (float)noise_weather_subdivisions_c, (float)noise_seed };
+		}
+		return { (float)noise_detail_resolution, noise_detail_persistence, (float)noise_detail_subdivisions_a, (float)noise_detail_subdivisions_b, (float)noise_detail_subdivisions_c, (float)noise_seed };
+	};
+	auto bake_noise_sliced = [&](int n) {
+		noise_cache* cache = noise_cached ? &noise_disk_cache : nullptr;
+		noise_baker* cpu = noise_cpu ? &noise_cpu_baker : nullptr;
+		switch (n) {
+			case 0:
+				bake_noise_main(noise_main_id, compute_shader_main, noise_main_resolution, noise_main_persistence, noise_main_subdivisions_a, noise_main_subdivisions_b, noise_main_subdivisions_c, noise_seed, cache, cpu, noise_jobs[0]);
+				break;
+			case 1:
+				bake_noise_weather(noise_weather_id, compute_shader_weather, noise_weather_resolution, noise_weather_persistence, noise_weather_subdivisions_a, noise_weather_subdivisions_b, noise_weather_subdivisions_c, noise_seed + 1, cache, cpu, noise_jobs[1]);
+				break;
+			case 2:
+				bake_noise_main(noise_detail_id, compute_shader_main, noise_detail_resolution, noise_detail_persistence, noise_detail_subdivisions_a, noise_detail_subdivisions_b, noise_detail_subdivisions_c, noise_seed + 2, cache, cpu, noise_jobs[2]);
+				break;
+		}
+		noise_job_states[n] = noise_job_state(n);
+	};
+
+	// rebakes the noise of the current model.
+	// sliced -> over the next frames
+	auto bake_cloud_noise = [&](bool sliced = false) {
+		if (sliced) {
+			for (int n = 0; n < 3; ++n) {
+				bake_noise_sliced(n);
+			}
+			return;
+		}
+		main_shader->unbind();
+		frame_profiler->gpu_begin("noise");
+		bake_noise_main(noise_main_id, compute_shader_main, noise_main_resolution, noise_main_persistence, noise_main_subdivisions_a, noise_main_subdivisions_b, noise_main_subdivisions_c, noise_seed, noise_cached ? &noise_disk_cache : nullptr, noise_cpu ? &noise_cpu_baker : nullptr);
+		bake_noise_weather(noise_weather_id, compute_shader_weather, noise_weather_resolution, noise_weather_persistence, noise_weather_subdivisions_a, noise_weather_subdivisions_b, noise_weather_subdivisions_c, noise_seed + 1, noise_cached ? &noise_disk_cache : nullptr, noise_cpu ? &noise_cpu_baker : nullptr);
+		bake_noise_weather_max(noise_weather_max_id, noise_weather_id, compute_shader_max_mip, noise_weather_resolution);
+		noise_weather_clipmap_dirty = true;
+		bake_noise_main(noise_detail_id, compute_shader_main, noise_detail_resolution, noise_detail_persistence, noise_detail_subdivisions_a, noise_detail_subdivisions_b, noise_detail_subdivisions_c, noise_seed + 2, noise_cached ? &noise_disk_cache : nullptr, noise_cpu ? &noise_cpu_baker : nullptr);
+		frame_profiler->gpu_end();
+		main_shader->bind();
+		main_shader->set1i("noise_main_texture", noise_main_id);
+		main_shader->set1i("noise_weather_texture", noise_weather_id);
+		main_shader->set1i("noise_detail_texture", noise_detail_id);
+		main_shader->unbind();
+		render_light_volume_dirty = true;
+		noise_packed_dirty = true;
+	};
+
+	// everything sized after the resolution
+	auto resize = [&]() {
+		glViewport(0, 0, resolution[0], resolution[1]);
+		delete render_cloud_targets[0];
+		delete render_cloud_targets[1];
+		render_cloud_targets[0] = nullptr;
+		render_cloud_targets[1] = nullptr;
+		delete render_tiled_target;
+		render_tiled_target = nullptr;
+		if (headless_screen) {
+			delete headless_screen;
+			headless_screen = new framebuffer(resolution[0], resolution[1]);
+			framebuffer::screen_id = headless_screen->framebuffer_id;
+			headless_screen->bind();
+		}
+		main_shader->bind();
+		main_shader->set2f("resolution", resolution[0], resolution[1]);
+		main_shader->unbind();
+	};
+
+	// camera uniforms for the current location
+	// and angles, with no motion to reproject
+	auto camera_view = [&]() {
+		glm::mat4 view = view_matrix;
+		view = glm::rotate(view, glm::radians(camera_yaw), glm::vec3(0.0f, 1.0f, 0.0f));
+		view = glm::rotate(view, glm::radians(camera_pitch), glm::vec3(1.0f, 0.0f, 0.0f));
+		return view;
+	};
+	auto set_camera = [&]() {
+		glm::mat4 view = camera_view();
+		main_shader->bind();
+		main_shader->set3f("camera_location", camera_location.x, camera_location.y, camera_location.z);
+		main_shader->set_mat4fv("view_matrix", view);
+		main_shader->set3f("previous_camera_location", camera_location.x, camera_location.y, camera_location.z);
+		main_shader->set_mat4fv("previous_view_matrix", view);
+	};
+
+	// ---- bench ---- //
+
+	// every preset along every camera path, at
+	// every resolution and sample count. presets
+	// go outermost so each is baked once.
+	struct bench_step {
+		int preset;
+		int path;
+		int resolution[2];
+		int volume_samples;
+		int in_scatter_samples;
+	};
+	bool bench = !launch.bench.empty();
+	std::vector<bench_step> bench_steps;
+	if (bench) {
+		std::vector<std::pair<int, int>> resolutions = { { 1280, 720 }, { 1920, 1080 } };
+		if (launch.resolution_set) {
+			resolutions = { { launch.resolution[0], launch.resolution[1] } };
+		}
+		const int volume_samples[] = { 16, 32, 64 };
+		const int in_scatter_samples[] = { 4, 8 };
+		for (int preset = 0; preset < IM_ARRAYSIZE(cloud_models); ++preset) {
+			for (std::pair<int, int> size : resolutions) {
+				for (int path = 0; path < IM_ARRAYSIZE(bench_paths); ++path) {
+					for (int volume : volume_samples) {
+						for (int in_scatter : in_scatter_samples) {
+							bench_steps.push_back({ preset, path, { size.first, size.second }, volume, in_scatter });
+						}
+					}
+				}
+			}
+		}
+	}
+	const int bench_warmup = 10;
+	int bench_frames = launch.frames_set ? launch.frames : 60;
+	size_t bench_index = 0;
+	int bench_frame = -bench_warmup;
+	int bench_preset = -1;
+	std::vector<float> bench_times;
+	bench_report bench_results;
+	std::chrono::steady_clock::time_point bench_timer = std::chrono::steady_clock::now();
+
+	// the same frame from the cpu renderer,
+	// reading back the noise textures
+	auto save_cpu_still = [&](const std::string& path, float animation_time) {
+		cpu_renderer renderer(launch.threads);
+		read_noise_texture(noise_main_id, noise_main_resolution, true, renderer.noise_main);
+		read_noise_texture(noise_weather_id, noise_weather_resolution, false, renderer.noise_weather);
+		read_noise_texture(noise_detail_id, noise_detail_resolution, true, renderer.noise_detail);
+		std::vector<unsigned char> pixels(resolution[0] * resolution[1] * 3);
+		renderer.render(gather_parameters(), camera_location, camera_view(), animation_time, resolution[0], resolution[1], pixels.data());
+		std::cout << "[+] Rendered on " << renderer.threads() << " cpu threads" << (renderer.avx2 ? ", avx2" : "") << " in " << renderer.time << " ms" << std::endl;
+		cv::Mat image(resolution[1], resolution[0], CV_8UC3);
+		pixels_to_mat(pixels.data(), image, resolution[0], resolution[1]);
+		if (cv::imwrite(path, image)) {
+			std::cout << "[+] Image written to " << path << std::endl;
+		} else {
+			std::cout << "[-] Couldn't write " << path << std::endl;
+		}
+	};
+
 	// ---- work ---- //
 
+	// the window updates the camera at the end of
+	// each frame. headless runs and sequences
+	// don't get there, their camera is set once.
+	if (headless || sequence) {
+		set_camera();
+		main_shader->set1f("render_temporal_blend", render_temporal_blend);
+		set_cloud_textures(main_shader);
+	}
+
+	if (sequence) {
+		video = video_output.open(launch.output, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), launch.sequence_fps, cv::Size(resolution[0], resolution[1]));
+		if (!video) {
+			std::cout << "[-] Couldn't open " << launch.output << std::endl;
+			run = false;
+		}
+	}
+
 	std::chrono::system_clock::time_point millis_start = std::chrono::system_clock::now();
+	std::chrono::system_clock::time_point sequence_timer = millis_start;
 
 	for (unsigned long long frame = 0; run; ++frame) {
 
 		millis_start = std::chrono::system_clock::now();
+		frame_profiler->frame();
+
+		// the window moves the clouds a thousandth
+		// per frame. sequences step by exactly one
+		// frame of their fps, at the speed the
+		// window has at 60 fps, so how long a frame
+		// takes never shows in the output.
+		float animation_time = frame / 1000.0f;
+		if (sequence) {
+			animation_time = (launch.sequence_start + frame / (float)launch.sequence_fps) * 60.0f / 1000.0f;
+		}
+
+		// benchmark steps set themselves up on
+		// their first warmup frame. the camera
+		// waits for the measured frames to move.
+		if (bench) {
+			const bench_step& step = bench_steps[bench_index];
+			if (bench_frame == -bench_warmup) {
+				if (step.preset != bench_preset) {
+					apply_cloud_model(step.preset);
+					glFinish();
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					bake_cloud_noise();
+					glFinish();
+					std::chrono::duration<float, std::milli> bake(std::chrono::steady_clock::now() - start);
+					bench_results.bakes.push_back({ cloud_models[step.preset], bake.count() });
+					bench_preset = step.preset;
+				}
+				if (step.resolution[0] != resolution[0] || step.resolution[1] != resolution[1]) {
+					resolution[0] = step.resolution[0];
+					resolution[1] = step.resolution[1];
+					resize();
+				}
+				// the sample counts only drive the fixed
+				// marcher, and in_scatter only the per
+				// pixel shadow rays without the light
+				// volume
+				render_adaptive_steps = false;
+				render_light_volume = false;
+				render_light_volume_dirty = true;
+				render_volume_samples = step.volume_samples;
+				render_in_scatter_samples = step.in_scatter_samples;
+				bench_times.clear();
+			}
+			float t = std::max(bench_frame, 0) / (float)bench_frames;
+			bench_camera(step.path, t, cloud_location, cloud_volume, camera_location, camera_pitch, camera_yaw);
+			set_camera();
+			animation_time = (bench_frame + bench_warmup) / 1000.0f;
+		}
 
 		glClearColor(0.0f, 0.0f, 0.0f, 1.00f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
-		glfwPollEvents();
-		if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-			run = false;
-			continue;
+		if (!headless) {
+			frame_profiler->cpu_begin("events");
+			glfwPollEvents();
+			frame_profiler->cpu_end();
+			if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+				run = false;
+				continue;
+			}
+		}
+
+		// sliced noise bakes, one at a time. what
+		// they bake is swapped in once it's done
+		for (int n = 0; n < 3; ++n) {
+			if (noise_jobs[n]->busy() && noise_job_state(n) != noise_job_states[n]) {
+				noise_jobs[n]->cancel();
+				std::cout << "[+] noise bake cancelled, its settings changed" << std::endl;
+			}
+		}
+		for (int n = 0; n < 3; ++n) {
+			if (!noise_jobs[n]->busy()) {
+				continue;
+			}
+			noise_jobs[n]->budget = noise_job_budget;
+			frame_profiler->gpu_begin("noise");
+			if (noise_jobs[n]->step()) {
+				if (n == 1) {
+					bake_noise_weather_max(noise_weather_max_id, noise_weather_id, compute_shader_max_mip, noise_weather_resolution);
+					noise_weather_clipmap_dirty = true;
+				} else {
+					noise_packed_dirty = true;
+				}
+				main_shader->bind();
+				set_cloud_textures(main_shader);
+				main_shader->unbind();
+				render_light_volume_dirty = true;
+			}
+			frame_profiler->gpu_end();
+			break;
+		}
+
+		// keep the weather clipmap centred on the
+		// camera, baking the texels it moves into
+		if (noise_weather_clipmap) {
+			float time = animation_time;
+			float center_u = camera_location.x / noise_weather_scale + noise_weather_offset[0] + wind_direction[0] * wind_speed * wind_weather_weight * time;
+			float center_v = camera_location.z / noise_weather_scale + noise_weather_offset[1] + wind_direction[2] * wind_speed * wind_weather_weight * time;
+			frame_profiler->gpu_begin("clipmap");
+			bake_noise_weather_clipmap(noise_weather_clipmap_id, compute_shader_weather, noise_weather_clipmap_resolution, noise_weather_clipmap_levels,
+					1.0f / noise_weather_resolution, noise_weather_clipmap_centers, noise_weather_clipmap_dirty, center_u, center_v, noise_seed + 1,
+					noise_weather_persistence, noise_weather_subdivisions_a, noise_weather_subdivisions_b, noise_weather_subdivisions_c);
+			frame_profiler->gpu_end();
+			if (noise_weather_clipmap_dirty) {
+				noise_weather_clipmap_dirty = false;
+				render_light_volume_dirty = true;
+			}
+		}
+
+		// parameters changed last frame, if any
+		frame_profiler->cpu_begin("parameters");
+		parameter_block->update(gather_parameters());
+		frame_profiler->cpu_end();
+
+		// rebuild occupancy grid. it's bounded by
+		// the weather texture, not the clipmap
+		if (render_empty_space_skipping && !noise_weather_clipmap) {
+			float time = animation_time;
+			frame_profiler->gpu_begin("occupancy");
+			compute_shader_occupancy->bind();
+			compute_shader_occupancy->set1i("output_texture", 0);
+			compute_shader_occupancy->set1i("weather_max_texture", noise_weather_max_id);
+			compute_shader_occupancy->set1i("weather_resolution", noise_weather_resolution);
+			compute_shader_occupancy->set1i("weather_levels", (int)std::log2(noise_weather_resolution) + 1);
+			compute_shader_occupancy->set1f("cloud_density_threshold", cloud_density_threshold);
+			compute_shader_occupancy->set1f("cloud_volume_edge_fade_distance", cloud_volume_edge_fade_distance);
+			compute_shader_occupancy->set3f("cloud_location", cloud_location[0], cloud_location[1], cloud_location[2]);
+			compute_shader_occupancy->set3f("cloud_volume", cloud_volume[0] / 2.0f, cloud_volume[1] / 2.0f, cloud_volume[2] / 2.0f);
+			compute_shader_occupancy->set1f("noise_weather_scale", noise_weather_scale);
+			compute_shader_occupancy->set2f("noise_weather_offset",
+					noise_weather_offset[0] + wind_direction[0] * wind_speed * wind_weather_weight * time,
+					noise_weather_offset[1] + wind_direction[2] * wind_speed * wind_weather_weight * time);
+			glBindImageTexture(0, occupancy_id, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R8);
+			glDispatchCompute((render_occupancy_resolution[0] + 3) / 4, (render_occupancy_resolution[1] + 3) / 4, (render_occupancy_resolution[2] + 3) / 4);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+			frame_profiler->gpu_end();
+		}
+
+		// rebake packed noise. detail repeats as
+		// many times as it fits in main's scale
+		if (noise_packed) {
+			int detail_repeat = std::max(1, (int)std::round(noise_main_scale / noise_detail_scale));
+			if (noise_packed_dirty || detail_repeat != noise_packed_detail_repeat) {
+				frame_profiler->gpu_begin("noise");
+				bake_noise_packed(noise_packed_id, compute_shader_packed, noise_main_resolution, detail_repeat,
+						noise_main_persistence, noise_main_subdivisions_a, noise_main_subdivisions_b, noise_main_subdivisions_c,
+						noise_detail_persistence, noise_detail_subdivisions_a, noise_detail_subdivisions_b, noise_detail_subdivisions_c,
+						noise_seed, noise_seed + 2);
+				frame_profiler->gpu_end();
+				noise_packed_dirty = false;
+				noise_packed_detail_repeat = detail_repeat;
+				render_light_volume_dirty = true;
+			}
+		}
+
+		// refresh light volume. everything is
+		// rebuilt when the light, the noise or the
+		// cloud change. otherwise a few slices per
+		// frame follow the wind.
+		if (render_light_volume) {
+			std::vector<float> state = {
+				light_direction[0], light_direction[1], light_direction[2],
+				cloud_volume_edge_fade_distance, cloud_absorption, cloud_density_threshold, cloud_density_multiplier,
+				cloud_location[0], cloud_location[1], cloud_location[2],
+				cloud_volume[0], cloud_volume[1], cloud_volume[2],
+				(float)render_in_scatter_samples, render_shadowing_max_distance, (float)render_empty_space_skipping, (float)render_noise_lod, (float)noise_packed, (float)noise_weather_clipmap,
+				noise_main_scale, noise_main_offset[0], noise_main_offset[1], noise_main_offset[2],
+				noise_weather_scale, noise_weather_offset[0], noise_weather_offset[1],
+				noise_detail_scale, noise_detail_weight, noise_detail_offset[0], noise_detail_offset[1], noise_detail_offset[2],
+				wind_direction[0], wind_direction[1], wind_direction[2], wind_speed,
+				wind_main_weight, wind_weather_weight, wind_detail_weight
+			};
+			int first = render_light_volume_slice;
+			int count = wind_speed != 0.0f ? render_light_volume_slices : 0;
+			if (render_light_volume_dirty || state != render_light_volume_state) {
+				first = 0;
+				count = render_light_volume_resolution[2];
+				render_light_volume_dirty = false;
+				render_light_volume_state = state;
+			}
+			if (count > 0) {
+				frame_profiler->gpu_begin("light volume");
+				compute_shader_light_volume->bind();
+				compute_shader_light_volume->set1i("output_texture", 0);
+				compute_shader_light_volume->set1f("animation_time", animation_time);
+				compute_shader_light_volume->set1i("slice_offset", first);
+				set_cloud_textures(compute_shader_light_volume);
+				glBindImageTexture(0, light_volume_id, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R16F);
+				glDispatchCompute((render_light_volume_resolution[0] + 3) / 4, (render_light_volume_resolution[1] + 3) / 4, (count + 3) / 4);
+				glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+				render_light_volume_slice = (first + count) % render_light_volume_resolution[2];
+				frame_profiler->gpu_end();
+			}
+		}
+
+		// rebake sky view when the light or the
+		// camera's height change
+		if (render_sky && render_sky_lut && (render_sky_lut_dirty || std::abs(camera_location.y - render_sky_lut_height) > 10.0f)) {
+			frame_profiler->gpu_begin("sky");
+			bake_atmosphere_sky(atmosphere_sky_id, compute_shader_sky, atmosphere_transmittance_id, light_direction, camera_location);
+			frame_profiler->gpu_end();
+			render_sky_lut_dirty = false;
+			render_sky_lut_height = camera_location.y;
+			main_shader->bind();
+			main_shader->set1i("sky_texture", atmosphere_sky_id);
 		}
 
 		// draw fragment to screen
+		frame_profiler->gpu_begin("clouds");
 		main_shader->bind();
+		main_shader->set1i("frame", frame);
+		main_shader->set1f("animation_time", animation_time);
+		main_shader->set1f("animation_time_step", animation_time - previous_animation_time);
+		previous_animation_time = animation_time;
 		glBindVertexArray(vao);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		if (render_temporal || render_cloud_divisor > 1) {
+			// clouds are rendered offscreen, then
+			// composited over the sky at full res.
+			int cloud_width = resolution[0] / render_cloud_divisor;
+			int cloud_height = resolution[1] / render_cloud_divisor;
+			if (render_cloud_targets[0] == nullptr) {
+				render_cloud_targets[0] = new framebuffer(cloud_width, cloud_height);
+				render_cloud_targets[1] = new framebuffer(cloud_width, cloud_height);
+				render_temporal_history_valid = false;
+			}
+			// ping-pong between targets when temporal:
+			// read last frame's, write this one's.
+			framebuffer* target = render_cloud_targets[render_cloud_target_index];
+			framebuffer* history = render_cloud_targets[1 - render_cloud_target_index];
+			// clouds only
+			main_shader->set1i("render_pass", 1);
+			main_shader->set2f("resolution", cloud_width, cloud_height);
+			main_shader->set1i("history_texture", history->texture_ids[0]);
+			if (!render_temporal_history_valid) {
+				main_shader->set1f("render_temporal_blend", 0.0f);
+			}
+			draw_pass(target);
+			// sky + upsampled clouds
+			glViewport(0, 0, resolution[0], resolution[1]);
+			main_shader->set1i("render_pass", 2);
+			main_shader->set2f("resolution", resolution[0], resolution[1]);
+			main_shader->set2f("cloud_resolution", cloud_width, cloud_height);
+			main_shader->set1i("cloud_texture", target->texture_ids[0]);
+			draw_pass(nullptr);
+			if (render_temporal) {
+				render_cloud_target_index = 1 - render_cloud_target_index;
+				render_temporal_history_valid = true;
+			}
+		} else {
+			main_shader->set1i("render_pass", 0);
+			draw_pass(nullptr);
+		}
+		frame_profiler->gpu_end();
 
-		// write to video buffer if the user is video
+		// write to video buffer if the user is video.
+		// the frame gets there a few frames later
 		if (video) {
-			cv::Mat pixels(resolution[1], resolution[0], CV_8UC3);
-			write_pixels_to_mat(pixels, resolution[0], resolution[1]);
-			video_output << pixels;
+			frame_profiler->gpu_begin("readback");
+			request_readback(readback_video);
+			frame_profiler->gpu_end();
+		}
+		frame_profiler->cpu_begin("encoding");
+		consume_readback(0);
+		frame_profiler->cpu_end();
+
+		// a benchmark frame is over once the gpu
+		// is done with it
+		if (bench) {
+			glFinish();
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			std::chrono::duration<float, std::milli> frame_time(now - bench_timer);
+			bench_timer = now;
+			if (bench_frame >= 0) {
+				bench_times.push_back(frame_time.count());
+			}
+			if (++bench_frame == bench_frames) {
+				const bench_step& step = bench_steps[bench_index];
+				bench_report::configuration c;
+				c.preset = cloud_models[step.preset];
+				c.path = bench_paths[step.path];
+				c.volume_samples = step.volume_samples;
+				c.in_scatter_samples = step.in_scatter_samples;
+				c.resolution[0] = step.resolution[0];
+				c.resolution[1] = step.resolution[1];
+				c.name = c.preset + "/" + c.path + "/" + std::to_string(c.resolution[0]) + "x" + std::to_string(c.resolution[1])
+					+ "/" + std::to_string(c.volume_samples) + "/" + std::to_string(c.in_scatter_samples)
+					+ (render_adaptive_steps ? "/adaptive" : "/fixed") + (render_light_volume ? "/light_volume" : "/direct");
+				bench_results.add(c, bench_times);
+				std::cout << "[" << bench_index + 1 << "/" << bench_steps.size() << "] " << c.name << " -> p50 " << bench_results.configurations.back().p50 << " ms" << std::endl;
+				bench_frame = -bench_warmup;
+				if (++bench_index == bench_steps.size()) {
+					std::string renderer = std::string((const char*)glGetString(GL_RENDERER)) + " | " + (const char*)glGetString(GL_VERSION);
+					if (bench_results.write(launch.bench, renderer, bench_warmup)) {
+						std::cout << "[+] Benchmark written to " << launch.bench << std::endl;
+					}
+					run = false;
+				}
+			}
+			continue;
+		}
+
+		// sequences skip the gui and the pacing.
+		// the last frame closes the video.
+		if (sequence) {
+			if (frame + 1 >= sequence_frames) {
+				consume_readback(-1);
+				video_encoder->finish();
+				video_output.release();
+				video = false;
+				std::chrono::duration<double> seconds(std::chrono::system_clock::now() - sequence_timer);
+				std::cout << "[+] " << sequence_frames << " frames written to " << launch.output << " in " << seconds.count() << " seconds" << std::endl;
+				run = false;
+			}
+			if (!headless) {
+				glfwSwapBuffers(window);
+			}
+			continue;
+		}
+
+		// headless runs write their last frame
+		// and leave. there's no gui to draw.
+		if (headless) {
+			if (frame + 1 >= (unsigned long long)launch.frames) {
+				if (launch.cpu) {
+					save_cpu_still(launch.output, animation_time);
+				} else if (launch.tiles > 0) {
+					save_tiled_still(launch.output, launch.resolution[0], launch.resolution[1], launch.tiles);
+				} else {
+					readback_images.push_back(launch.output);
+					request_readback(readback_image);
+					consume_readback(-1);
+				}
+				run = false;
+			}
+			continue;
 		}
 
 		// --------------- //
@@ -602,6 +1626,7 @@ int main(int argc, char* argv[]) {
 		// check for ever rendered window
 		bool imgui_window_is_focused = false;
 
+		frame_profiler->cpu_begin("gui");
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
@@ -635,39 +1660,12 @@ int main(int argc, char* argv[]) {
 					break;
 				}
 			}
-			cloud model = clouds[i];
-			cloud_absorption = model.cloud_absorption;
-			cloud_density_threshold = model.cloud_density_threshold;
-			cloud_density_multiplier = model.cloud_density_multiplier;
-			cloud_location[0] = model.cloud_location[0];
-			cloud_location[1] = model.cloud_location[1];
-			cloud_location[2] = model.cloud_location[2];
-			cloud_volume[1] = model.cloud_volume_width;
-			noise_main_subdivisions_a = model.noise_main_subdivisions_a;
-			noise_main_subdivisions_b = model.noise_main_subdivisions_b;
-			noise_main_subdivisions_c = model.noise_main_subdivisions_c;
-			noise_main_persistence = model.noise_main_persistence;
-			noise_main_scale = model.noise_main_scale;
-			noise_weather_subdivisions_a = model.noise_weather_subdivisions_a;
-			noise_weather_subdivisions_b = model.noise_weather_subdivisions_b;
-			noise_weather_subdivisions_c = model.noise_weather_subdivisions_c;
-			noise_weather_persistence = model.noise_weather_persistence;
-			noise_weather_scale = model.noise_weather_scale;
-			noise_detail_subdivisions_a = model.noise_detail_subdivisions_a;
-			noise_detail_subdivisions_b = model.noise_detail_subdivisions_b;
-			noise_detail_subdivisions_c = model.noise_detail_subdivisions_c;
-			noise_detail_persistence = model.noise_detail_persistence;
-			noise_detail_scale = model.noise_detail_scale;
-			noise_detail_weight = model.noise_detail_weight;
-			main_shader->unbind();
-			bake_noise_main(noise_main_id, compute_shader_main, noise_main_resolution, noise_main_persistence, noise_main_subdivisions_a, noise_main_subdivisions_b, noise_main_subdivisions_c);
-			bake_noise_weather(noise_weather_id, compute_shader_weather, noise_weather_resolution, noise_weather_persistence, noise_weather_subdivisions_a, noise_weather_subdivisions_b, noise_weather_subdivisions_c);
-			bake_noise_main(noise_detail_id, compute_shader_main, noise_detail_resolution, noise_detail_persistence, noise_detail_subdivisions_a, noise_detail_subdivisions_b, noise_detail_subdivisions_c);
-			main_shader->bind();
-			main_shader->set1i("noise_main_texture", noise_main_id);
-			main_shader->set1i("noise_weather_texture", noise_weather_id);
-			main_shader->set1i("noise_detail_texture", noise_detail_id);
-			main_shader->unbind();
+			apply_cloud_model(i);
+			bake_cloud_noise(true);
+		}
+		if (noise_jobs[0]->busy() || noise_jobs[1]->busy() || noise_jobs[2]->busy()) {
+			float progress = (noise_jobs[0]->progress + noise_jobs[1]->progress + noise_jobs[2]->progress) / 3.0f;
+			ImGui::ProgressBar(progress, ImVec2(-1.0f, 0.0f), "baking noise");
 		}
 		if (ImGui::CollapsingHeader("cloud")) {
 			ImGui::InputFloat3("volume", &cloud_volume[0]); ImGui::SameLine();
@@ -695,12 +1693,51 @@ int main(int argc, char* argv[]) {
 			ImGui::Text("weather");
 			ImGui::SliderFloat("scale##2", &noise_weather_scale, 1.0f, 512.0f);
 			ImGui::SliderFloat2("offset##2", &noise_weather_offset[0], 0.0f, 1.0f);
+			ImGui::Checkbox("clipmap", &noise_weather_clipmap); ImGui::SameLine();
+			imgui_help_marker("weather that doesn't repeat, baked in\n"
+					"rings around the camera as it moves.\n"
+					"empty space skipping is turned off\n"
+					"meanwhile.");
 			ImGui::Text("detail");
 			ImGui::SliderFloat("scale##3", &noise_detail_scale, 1.0f, 32.0f);
 			ImGui::SliderFloat("weight##2", &noise_detail_weight, 0.0f, 1.0f);
 			ImGui::SliderFloat3("offset##3", &noise_detail_offset[0], 0.0f, 1.0f);
+			ImGui::Checkbox("packed", &noise_packed); ImGui::SameLine();
+			imgui_help_marker("bake main and detail noise into a single\n"
+					"texture, read with one fetch.\n"
+					"detail then moves along with main, and\n"
+					"its scale snaps to a whole fraction of\n"
+					"main's.");
 			ImGui::Separator();
 			ImGui::Text("rebake noise textures");
+			ImGui::Checkbox("bake on the cpu", &noise_cpu); ImGui::SameLine();
+			imgui_help_marker("main, weather and detail noise are baked\n"
+					"by every core of the cpu instead of a\n"
+					"compute shader. same points, same noise.");
+			ImGui::InputInt("seed", &noise_seed); ImGui::SameLine();
+			imgui_help_marker("random points of every texture are hashed\n"
+					"from it. same seed, same noise.");
+			ImGui::Checkbox("cache", &noise_cached); ImGui::SameLine();
+			imgui_help_marker("bakes are kept in ./cache/ and loaded\n"
+					"from there when the seed and settings\n"
+					"come up again.");
+			ImGui::SliderFloat("budget", &noise_job_budget, 0.5f, 16.0f, "%.1f ms"); ImGui::SameLine();
+			imgui_help_marker("gpu time a frame gives to baking. slices\n"
+					"are baked into a new texture over the\n"
+					"next frames, the current one is shown\n"
+					"until it's done.");
+			const char* noise_job_names[] = { "main", "weather", "detail" };
+			for (int n = 0; n < 3; ++n) {
+				if (noise_jobs[n]->busy()) {
+					ImGui::PushID(n);
+					if (ImGui::Button("cancel")) {
+						noise_jobs[n]->cancel();
+					}
+					ImGui::SameLine();
+					ImGui::ProgressBar(noise_jobs[n]->progress, ImVec2(-1.0f, 0.0f), noise_job_names[n]);
+					ImGui::PopID();
+				}
+			}
 			if (ImGui::TreeNode("main##1")) {
 				ImGui::Text("three dimensional worley noise texture\nused to define the shape of the clouds.");
 				ImGui::InputInt("resolution##1", &noise_main_resolution); ImGui::SameLine();
@@ -715,14 +1752,10 @@ int main(int argc, char* argv[]) {
 				ImGui::InputInt("B##1", &noise_main_subdivisions_b);
 				ImGui::InputInt("C##1", &noise_main_subdivisions_c);
 				if (ImGui::Button("bake##1")) {
-					main_shader->unbind();
-					bake_noise_main(noise_main_id, compute_shader_main, noise_main_resolution, noise_main_persistence, noise_main_subdivisions_a, noise_main_subdivisions_b, noise_main_subdivisions_c);
-					main_shader->bind();
-					main_shader->set1i("noise_main_texture", noise_main_id);
-					main_shader->unbind();
+					bake_noise_sliced(0);
 				}
 				ImGui::SameLine();
-				imgui_help_marker("bake at your own risk.\nbig values may take some time to compute\nor may freeze your computer.", true);
+				imgui_help_marker("baked a few slices a frame.\nbig values may take some time to compute.", true);
 				ImGui::TreePop();
 			}
 			if (ImGui::TreeNode("weather##1")) {
@@ -739,14 +1772,10 @@ int main(int argc, char* argv[]) {
 				ImGui::InputInt("B##2", &noise_weather_subdivisions_b);
 				ImGui::InputInt("C##2", &noise_weather_subdivisions_c);
 				if (ImGui::Button("bake##2")) {
-					main_shader->unbind();
-					bake_noise_weather(noise_weather_id, compute_shader_weather, noise_weather_resolution, noise_weather_persistence, noise_weather_subdivisions_a, noise_weather_subdivisions_b, noise_weather_subdivisions_c);
-					main_shader->bind();
-					main_shader->set1i("noise_weather_texture", noise_weather_id);
-					main_shader->unbind();
+					bake_noise_sliced(1);
 				}
 				ImGui::SameLine();
-				imgui_help_marker("bake at your own risk.\nbig values may take some time to compute\nor may freeze your computer.", true);
+				imgui_help_marker("baked a few slices a frame.\nbig values may take some time to compute.", true);
 				ImGui::TreePop();
 			}
 			if (ImGui::TreeNode("detail##1")) {
@@ -763,14 +1792,10 @@ int main(int argc, char* argv[]) {
 				ImGui::InputInt("B##3", &noise_detail_subdivisions_b);
 				ImGui::InputInt("C##3", &noise_detail_subdivisions_c);
 				if (ImGui::Button("bake##3")) {
-					main_shader->unbind();
-					bake_noise_main(noise_detail_id, compute_shader_main, noise_detail_resolution, noise_detail_persistence, noise_detail_subdivisions_a, noise_detail_subdivisions_b, noise_detail_subdivisions_c);
-					main_shader->bind();
-					main_shader->set1i("noise_detail_texture", noise_detail_id);
-					main_shader->unbind();
+					bake_noise_sliced(2);
 				}
 				ImGui::SameLine();
-				imgui_help_marker("bake at your own risk.\nbig values may take some time to compute\nor may freeze your computer.", true);
+				imgui_help_marker("baked a few slices a frame.\nbig values may take some time to compute.", true);
 				ImGui::TreePop();
 			}
 		}
@@ -781,6 +1806,11 @@ int main(int argc, char* argv[]) {
 			ImGui::Checkbox("physically accurate sky", &render_sky);
 			if (!render_sky) {
 				ImGui::ColorEdit3("background color", &background_color[0]);
+			} else {
+				ImGui::Checkbox("sky lookup table", &render_sky_lut); ImGui::SameLine();
+				imgui_help_marker("precompute the sky for every direction\n"
+						"whenever the light changes instead of\n"
+						"scattering light for every pixel.");
 			}
 			ImGui::Separator();
 			ImGui::Text("light direction");
@@ -794,41 +1824,14 @@ int main(int argc, char* argv[]) {
 				light_direction_modified |= ImGui::SliderFloat("y", &light_direction[1], -1.0f, 1.0f);
 				light_direction_modified |= ImGui::SliderFloat("z", &light_direction[2], -1.0f, 1.0f);
 			} else if (light_direction_method_modified || ImGui::SliderFloat("time", &time, 6.0f, 18.0f)) {
-				// sunrise - 6:00am
-				// sunset  - 6:00pm
-				light_direction[0] = 0.0f;
-				light_direction[1] = (time - 6.0f) / 6.0f;
-				light_direction[2] = light_direction[1] - 1.0f;
-				if (time > 12.0f) {
-					light_direction[1] = 2.0f - light_direction[1];
-				}
+				light_direction_from_time(time, light_direction);
 				light_direction_modified = true;
 			}
 			// normalize light direction and update shader
 			if (light_direction_modified) {
-				// normalize light direction and update shader
-				float light_direction_module = std::sqrt(light_direction[0] * light_direction[0] + light_direction[1] * light_direction[1] + light_direction[2] * light_direction[2]);
-				light_direction[0] /= light_direction_module;
-				light_direction[1] /= light_direction_module;
-				light_direction[2] /= light_direction_module;
-				// update in shader
-				main_shader->set3f("light_direction", light_direction[0], light_direction[1], light_direction[2]);
-				if (light_direction[0] == 0.0f) {
-					inverse_light_direction[0] = 1.0f;
-				} else {
-					inverse_light_direction[0] = 1.0f / light_direction[0];
-				}
-				if (light_direction[1] == 0.0f) {
-					inverse_light_direction[1] = 1.0f;
-				} else {
-					inverse_light_direction[1] = 1.0f / light_direction[1];
-				}
-				if (light_direction[2] == 0.0f) {
-					inverse_light_direction[2] = 1.0f;
-				} else {
-					inverse_light_direction[2] = 1.0f / light_direction[2];
-				}
-				main_shader->set3f("inverse_light_direction", inverse_light_direction[0], inverse_light_direction[1], inverse_light_direction[2]);
+				light_direction_normalize(light_direction, inverse_light_direction);
+				render_sky_lut_dirty = true;
+				render_light_volume_dirty = true;
 			}
 		}
 
@@ -876,29 +1879,133 @@ int main(int argc, char* argv[]) {
 				}
 				// update ideal frame time
 				millis_per_frame = 1000 / fps;
-				// update shaders' viewport
-				glViewport(0, 0, resolution[0], resolution[1]);
-				// update in shader
-				main_shader->bind();
-				main_shader->set2f("resolution", resolution[0], resolution[1]);
-				main_shader->unbind();
+				resize();
 			}
 			ImGui::Separator();
 			ImGui::Text("number of samples taken");
 			ImGui::SliderInt("per ray", &render_volume_samples, 8, 128); ImGui::SameLine();
 			imgui_help_marker("number of noise samples taken along the\nmain ray");
+			ImGui::Checkbox("adaptive steps", &render_adaptive_steps); ImGui::SameLine();
+			imgui_help_marker("step through clear air with long steps\n"
+					"and through clouds with short ones,\n"
+					"instead of a fixed number of samples.");
+			if (render_adaptive_steps) {
+				ImGui::SliderFloat("min step", &render_step_min, 0.05f, render_step_max);
+				ImGui::SliderFloat("max step", &render_step_max, render_step_min, 16.0f);
+			}
 			ImGui::SliderInt("in scatter", &render_in_scatter_samples, 4, 64); ImGui::SameLine();
 			imgui_help_marker("number of noise samples taken to compute\nthe in scattered light for each sample\nof the primary ray.");
-			ImGui::Text("number of calls to the noise sampling function: %d", render_volume_samples * render_in_scatter_samples);
+			// only a fixed count with neither
+			if (!render_adaptive_steps && !render_light_volume) {
+				ImGui::Text("number of calls to the noise sampling function: %d", render_volume_samples * render_in_scatter_samples);
+			}
 			ImGui::Separator();
 			ImGui::Text("shadowing");
 			ImGui::InputFloat("distance", &render_shadowing_max_distance); ImGui::SameLine();
 			imgui_help_marker("maximum distance at which shadows will\nbe casted.");
 			ImGui::SliderFloat("weight", &render_shadowing_weight, 0.0f, 1.0f);
+			ImGui::Separator();
+			ImGui::Checkbox("empty space skipping", &render_empty_space_skipping); ImGui::SameLine();
+			imgui_help_marker("leap over parts of the volume where the\n"
+					"weather map guarantees there are no\n"
+					"clouds instead of sampling them.");
+			ImGui::Checkbox("noise level of detail", &render_noise_lod); ImGui::SameLine();
+			imgui_help_marker("read far away and shadow samples from\n"
+					"lower resolution versions of the noise,\n"
+					"which are faster to sample and don't\n"
+					"flicker.");
+			ImGui::Checkbox("light volume", &render_light_volume); ImGui::SameLine();
+			imgui_help_marker("fetch shadowing from a volume that's\n"
+					"marched toward the light once, instead\n"
+					"of marching it from every sample.");
+			if (render_light_volume) {
+				ImGui::SliderInt("slices per frame", &render_light_volume_slices, 4, render_light_volume_resolution[2]); ImGui::SameLine();
+				imgui_help_marker("depth slices of the light volume that\n"
+						"are refreshed every frame to follow\n"
+						"the wind.");
+			}
+			ImGui::Separator();
+			ImGui::Text("clouds");
+			if (ImGui::BeginCombo("resolution##clouds", render_cloud_resolution)) {
+				for (int n = 0; n < IM_ARRAYSIZE(render_cloud_resolutions); ++n) {
+					bool is_selected = (render_cloud_resolution == render_cloud_resolutions[n]);
+					if (ImGui::Selectable(render_cloud_resolutions[n], is_selected)) {
+						render_cloud_resolution = render_cloud_resolutions[n];
+						render_cloud_divisor = 1 << n;
+						delete render_cloud_targets[0];
+						delete render_cloud_targets[1];
+						render_cloud_targets[0] = nullptr;
+						render_cloud_targets[1] = nullptr;
+					}
+					if (is_selected) {
+						ImGui::SetItemDefaultFocus();	
+					}
+				}
+				ImGui::EndCombo();
+			}
+			ImGui::SameLine();
+			imgui_help_marker("resolution at which clouds are marched.\n"
+					"they're upsampled and composited over the\n"
+					"full resolution sky afterwards.");
+			ImGui::Checkbox("tiled compute", &render_tiled); ImGui::SameLine();
+			imgui_help_marker("render with compute shaders in 8x8\n"
+					"tiles. tiles that don't see the cloud\n"
+					"volume only compute the sky.");
+			ImGui::Separator();
+			ImGui::Text("temporal");
+			if (ImGui::Checkbox("reprojection", &render_temporal)) {
+				render_temporal_history_valid = false;
+			}
+			ImGui::SameLine();
+			imgui_help_marker("jitter the ray start every frame and blend\n"
+					"the result with the previous frames'.\n"
+					"allows for far less samples per ray at\n"
+					"similar quality.");
+			if (render_temporal) {
+				ImGui::SliderFloat("history weight", &render_temporal_blend, 0.0f, 0.98f); ImGui::SameLine();
+				imgui_help_marker("fraction of the previous frames kept.\nhigher values converge to a smoother\nimage but trail more behind motion.");
+				ImGui::SliderFloat("max rotation", &render_temporal_max_rotation, 0.0f, 10.0f); ImGui::SameLine();
+				imgui_help_marker("degrees the camera can turn in a frame\nbefore the history is discarded.");
+				ImGui::InputFloat("max translation", &render_temporal_max_translation); ImGui::SameLine();
+				imgui_help_marker("distance the camera can move in a frame\nbefore the history is discarded.");
+			}
+			ImGui::Separator();
+			ImGui::Text("shaders");
+			if (ImGui::Button("reload")) {
+				shader* programs[] = { compute_shader_main, compute_shader_weather, compute_shader_packed, compute_shader_max_mip, compute_shader_occupancy, compute_shader_transmittance, compute_shader_sky, compute_shader_light_volume, main_shader,
+					compute_shader_tiles, compute_shader_render_clouds, compute_shader_render_sky };
+				for (shader* program : programs) {
+					if (program) program->reload();
+				}
+			}
+			ImGui::SameLine();
+			imgui_help_marker("rebuild the shaders from ./data in the\n"
+					"background. the current ones are kept\n"
+					"on screen until the new ones link.");
+			if (main_shader->compiling()) {
+				ImGui::SameLine();
+				ImGui::Text("compiling...");
+			}
 		}
 
 		// ---- export ---- //
 
+		if (ImGui::CollapsingHeader("profiler")) {
+			ImGui::InputText("name##trace", trace_name, 32);
+			if (!frame_profiler->tracing) {
+				if (ImGui::Button("start trace")) {
+					frame_profiler->clear_trace();
+					frame_profiler->tracing = true;
+				}
+			} else if (ImGui::Button("stop and save trace")) {
+				frame_profiler->flush();
+				frame_profiler->tracing = false;
+				frame_profiler->export_trace(std::string(trace_name) + ".json");
+			}
+			ImGui::SameLine();
+			imgui_help_marker("chrome trace of every pass while it runs.\nopen it in chrome://tracing or\nui.perfetto.dev");
+		}
+
 		if (ImGui::CollapsingHeader("export")) {
 			ImGui::Text("image");
 			ImGui::InputText("name##image", image_name, 32);
@@ -915,9 +2022,16 @@ int main(int argc, char* argv[]) {
 				ImGui::EndCombo();
 			}
 			if (ImGui::Button("save")) {
-				cv::Mat pixels(resolution[1], resolution[0], CV_8UC3);
-				write_pixels_to_mat(pixels, resolution[0], resolution[1]);
-				cv::imwrite(std::string(image_name) + std::string(image_format), pixels);
+				readback_images.push_back(std::string(image_name) + std::string(image_format));
+				request_readback(readback_image);
+			}
+			ImGui::InputInt2("tiled size##image", &image_tiled_resolution[0]); ImGui::SameLine();
+			imgui_help_marker("rendered and written a tile at a time, so\nit can be larger than any framebuffer.\nwritten as .ppm if that's the format,\nas .tif otherwise.");
+			ImGui::InputInt("tile##image", &image_tile_size);
+			image_tile_size = std::max(image_tile_size, 64);
+			if (ImGui::Button("save tiled")) {
+				std::string extension = std::strcmp(image_format, ".ppm") == 0 ? ".ppm" : ".tif";
+				save_tiled_still(std::string(image_name) + extension, image_tiled_resolution[0], image_tiled_resolution[1], image_tile_size);
 			}
 			ImGui::Separator();
 			ImGui::Text("video");
@@ -954,6 +2068,8 @@ int main(int argc, char* argv[]) {
 				// stop?
 				if (ImGui::Button("stop recording")) {
 					video = false;
+					consume_readback(-1);
+					video_encoder->finish();
 					video_output.release();
 				}
 			}
@@ -992,57 +2108,56 @@ int main(int argc, char* argv[]) {
 			ImGui::Text("~~~~~~~~~~~~");
 			ImGui::Text("fps    -> %.3f", last_fps);
 			ImGui::Text("angles -> %.1f | %.1f", camera_pitch, camera_yaw);
+			if (video && readback) {
+				ImGui::Text("read   -> %.2f ms | %d frames", readback->latency, readback->latency_frames);
+				ImGui::Text("encode -> %d queued | %llu stalls", video_encoder->queued(), video_encoder->stalls);
+			}
+			// rolling averages, a frame behind for
+			// the cpu and a few for the gpu
+			ImGui::Text("~~~~~~~~~~~~");
+			for (const profiler::stat& stat : frame_profiler->stats) {
+				ImGui::Text("%s %-12s %6.2f ms", stat.gpu ? "gpu" : "cpu", stat.name.c_str(), stat.average);
+			}
 		}
 		ImGui::End();
 
 		// render gui to frame
 		ImGui::Render();
+		frame_profiler->cpu_end();
+		frame_profiler->gpu_begin("imgui");
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		frame_profiler->gpu_end();
 
 		// compute angles
 		glm::mat4 view = view_matrix;
 		view = glm::rotate(view, glm::radians(camera_yaw), glm::vec3(0.0f, 1.0f, 0.0f));
 		view = glm::rotate(view, glm::radians(camera_pitch), glm::vec3(1.0f, 0.0f, 0.0f));
 
-		// update frame counter
-		main_shader->set1i("frame", frame);
-
 		// camera
 		main_shader->set3f("camera_location", camera_location.x, camera_location.y, camera_location.z);
 		main_shader->set_mat4fv("view_matrix", view);
 
-		// cloud
-		main_shader->set1f("cloud_volume_edge_fade_distance", cloud_volume_edge_fade_distance);
-		main_shader->set1f("cloud_absorption", cloud_absorption);
-		main_shader->set1f("cloud_density_threshold", cloud_density_threshold);
-		main_shader->set1f("cloud_density_multiplier", cloud_density_multiplier);
-		main_shader->set3f("cloud_location", cloud_location[0], cloud_location[1], cloud_location[2]);
-		main_shader->set3f("cloud_volume", cloud_volume[0] / 2.0f, cloud_volume[1] / 2.0f, cloud_volume[2] / 2.0f);
-
-		// rendering
-		main_shader->set1i("render_volume_samples", render_volume_samples);
-		main_shader->set1i("render_in_scatter_samples", render_in_scatter_samples);
-		main_shader->set1f("render_shadowing_max_distance", render_shadowing_max_distance);
-		main_shader->set1f("render_shadowing_weight", render_shadowing_weight);
-
-		// noise
-		main_shader->set1f("noise_main_scale", noise_main_scale);
-		main_shader->set3f("noise_main_offset", noise_main_offset[0], noise_main_offset[1], noise_main_offset[2]);
-		main_shader->set1f("noise_weather_scale", noise_weather_scale);
-		main_shader->set2f("noise_weather_offset", noise_weather_offset[0], noise_weather_offset[1]);
-		main_shader->set1f("noise_detail_scale", noise_detail_scale);
-		main_shader->set1f("noise_detail_weight", noise_detail_weight);
-		main_shader->set3f("noise_detail_offset", noise_detail_offset[0], noise_detail_offset[1], noise_detail_offset[2]);
-
-		// wind
-		main_shader->set3f("wind_vector", wind_direction[0] * wind_speed, wind_direction[1] * wind_speed, wind_direction[2] * wind_speed);
-		main_shader->set1f("wind_main_weight", wind_main_weight);
-		main_shader->set1f("wind_weather_weight", wind_weather_weight);
-		main_shader->set1f("wind_detail_weight", wind_detail_weight);
+		// temporal
+		{
+			// discard history when the camera moves
+			// too fast for reprojection to hold up
+			glm::vec4 forward = view * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f);
+			glm::vec4 previous_forward = previous_view_matrix * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f);
+			float rotation_cos = forward.x * previous_forward.x + forward.y * previous_forward.y + forward.z * previous_forward.z;
+			float rotation = glm::degrees(std::acos(std::min(1.0f, rotation_cos)));
+			float translation = glm::length(camera_location - previous_camera_location);
+			bool camera_too_fast = rotation > render_temporal_max_rotation || translation > render_temporal_max_translation;
+			main_shader->set1f("render_temporal_blend", camera_too_fast ? 0.0f : render_temporal_blend);
+			main_shader->set3f("previous_camera_location", previous_camera_location.x, previous_camera_location.y, previous_camera_location.z);
+			main_shader->set_mat4fv("previous_view_matrix", previous_view_matrix);
+			previous_view_matrix = view;
+			previous_camera_location = camera_location;
+		}
 
-		// skydome
-		main_shader->set1i("render_sky", render_sky);
-		main_shader->set3f("background_color", background_color[0], background_color[1], background_color[2]);
+		// textures. everything else goes through
+		// the parameters block
+		main_shader->bind();
+		set_cloud_textures(main_shader);
 
 		// update screen with new frame
 		glfwSwapBuffers(window);
@@ -1060,12 +2175,48 @@ int main(int argc, char* argv[]) {
 
 	// ---- cleanup ---- //
 
-	glfwTerminate();
+	// reads still in flight end up on disk
+	consume_readback(-1);
+	delete readback;
+	// the run's trace, if asked for
+	if (frame_profiler->tracing && !launch.trace.empty()) {
+		frame_profiler->flush();
+		frame_profiler->export_trace(launch.trace);
+	}
+	for (bake_job* job : noise_jobs) {
+		delete job;
+	}
+	delete frame_profiler;
+	delete video_encoder;
+	delete image_encoder;
+	delete render_cloud_targets[0];
+	delete render_cloud_targets[1];
+	delete render_tiled_target;
+	glDeleteBuffers(1, &render_tiled_buffer);
+	delete parameter_block;
+	delete headless_screen;
 
 	delete compute_shader_main;
 	delete compute_shader_weather;
 	delete compute_shader_cirro;
+	delete compute_shader_packed;
+	delete compute_shader_max_mip;
+	delete compute_shader_occupancy;
+	delete compute_shader_transmittance;
+	delete compute_shader_sky;
+	delete compute_shader_light_volume;
 	delete main_shader;
+	delete compute_shader_tiles;
+	delete compute_shader_render_clouds;
+	delete compute_shader_render_sky;
+
+	// programs go before the context they
+	// live in
+	if (headless) {
+		headless_terminate();
+	} else {
+		glfwTerminate();
+	}
 
 	return 0;
 }
@@ -1084,36 +2235,198 @@ void cursor_position_callback(GLFWwindow* window, double x, double y) {
 // -------- noise texture -------- //
 // ------------------------------- //
 
-void compute_worley_grid(glm::vec4* points, int subdivision, bool weather = false) {
-	float cell_size = 1.0f / (float)subdivision;
-	for (int i = 0; i < subdivision; ++i) {
-		for (int j = 0; j < subdivision; ++j) {
-			if (!weather) { // main noise
-				for (int k = 0; k < subdivision; ++k) {
-					float x = (float)rand()/(float)(RAND_MAX);
-					float y = (float)rand()/(float)(RAND_MAX);
-					float z = (float)rand()/(float)(RAND_MAX);
-					glm::vec3 offset = glm::vec3(i, j, k) * cell_size;
-					glm::vec3 corner = glm::vec3(x, y, z) * cell_size;
-					points[i + subdivision * (j + k * subdivision)] = glm::vec4(offset + corner, 0.0f);
-				}
-			} else { // weather map
-				float x = (float)rand() / (float)(RAND_MAX);
-				float y = (float)rand() / (float)(RAND_MAX);
-				glm::vec2 offset = glm::vec2(i, j) * cell_size;
-				glm::vec2 corner = glm::vec2(x, y) * cell_size;
-				points[i + j * subdivision] = glm::vec4(offset + corner, 0.0f, 0.0f);
-			}
+// ---- 3d worley FBM ---- //
+void bake_noise_main(unsigned int &texture_id, shader* compute, int resolution, float persistance, int subdivisions_a, int subdivisions_b, int subdivisions_c, int seed, noise_cache* cache, noise_baker* cpu, bake_job* job) {
+	// a job bakes into a texture of its own,
+	// the current one is sampled until then.
+	// otherwise it's replaced right away
+	unsigned int baked_id = 0;
+	if (job) {
+		job->cancel();
+	} else if (glIsTexture(texture_id)) {
+		glDeleteTextures(1, &texture_id);
+		std::cout << "[+] baking new noise texture" << std::endl;
+	}
+	glGenTextures(1, &baked_id);
+	if (!job) {
+		texture_id = baked_id;
+	}
+	glActiveTexture(GL_TEXTURE0 + baked_id);
+	glBindTexture(GL_TEXTURE_3D, baked_id);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+	// trilinear. the shader picks the level
+	// from each sample's footprint
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, resolution, resolution, resolution, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+
+	const int subdivisions[3] = { subdivisions_a, subdivisions_b, subdivisions_c };
+	if (cache && cache->load(true, resolution, persistance, subdivisions, seed)) {
+		std::cout << "[+] noise loaded from the cache in " << cache->time << " ms" << std::endl;
+		glGenerateMipmap(GL_TEXTURE_3D);
+		if (job) job->start(&texture_id, baked_id);
+		return;
+	}
+
+	if (cpu) {
+		std::vector<unsigned char> texels((size_t)resolution * resolution * resolution);
+		cpu->bake_volume(texels.data(), resolution, persistance, seed, subdivisions);
+		std::cout << "[+] noise baked on " << cpu->threads << " cpu threads in " << cpu->time << " ms" << std::endl;
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, resolution, resolution, resolution, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateMipmap(GL_TEXTURE_3D);
+		if (cache) {
+			cache->store(true, resolution, persistance, subdivisions, seed, texels.data());
+		}
+		if (job) job->start(&texture_id, baked_id);
+		return;
+	}
+
+	// set shader variables. again before every
+	// dispatch of a job, other bakes may have
+	// used the program since
+	auto bind = [=]() {
+		compute->bind();
+		compute->set1i("output_texture", 0);
+		compute->set1i("resolution", resolution);
+		compute->set1f("persistance", persistance);
+		compute->set1i("subdivisions_a", subdivisions_a);
+		compute->set1i("subdivisions_b", subdivisions_b);
+		compute->set1i("subdivisions_c", subdivisions_c);
+		compute->set1i("seed", seed);
+		glBindImageTexture(0, baked_id, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R8);
+	};
+
+	// far away and shadow samples read from
+	// the coarser levels
+	auto finish = [=](bool baked) {
+		if (!baked) {
+			return;
 		}
+		glActiveTexture(GL_TEXTURE0 + baked_id);
+		glBindTexture(GL_TEXTURE_3D, baked_id);
+		glGenerateMipmap(GL_TEXTURE_3D);
+		if (cache) {
+			std::vector<unsigned char> texels((size_t)resolution * resolution * resolution);
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+			glPixelStorei(GL_PACK_ALIGNMENT, 4);
+			cache->store(true, resolution, persistance, subdivisions, seed, texels.data());
+		}
+	};
+
+	if (job) {
+		job->start(&texture_id, baked_id, compute, true, resolution, bind, finish);
+		return;
 	}
+
+	// dispatch compute shader
+	bind();
+	compute->set1i("slice_offset", 0);
+	glDispatchCompute(resolution / 8, resolution / 8, resolution / 8);
+
+	// wait till finished
+	glMemoryBarrier(GL_ALL_BARRIER_BITS);
+
+	finish(true);
 }
 
-// ---- 3d worley FBM ---- //
-void bake_noise_main(unsigned int &texture_id, shader* compute, int resolution, float persistance, int subdivisions_a, int subdivisions_b, int subdivisions_c) {
+// ---- 2d worley FBM ---- //
+void bake_noise_weather(unsigned int &texture_id, shader* compute, int resolution, float persistance, int subdivisions_a, int subdivisions_b, int subdivisions_c, int seed, noise_cache* cache, noise_baker* cpu, bake_job* job) {
+	// a job bakes into a texture of its own,
+	// as above
+	unsigned int baked_id = 0;
+	if (job) {
+		job->cancel();
+	} else if (glIsTexture(texture_id)) {
+		glDeleteTextures(1, &texture_id);
+		std::cout << "[+] baking new weather texture" << std::endl;
+	}
+	glGenTextures(1, &baked_id);
+	if (!job) {
+		texture_id = baked_id;
+	}
+	glActiveTexture(GL_TEXTURE0 + baked_id);
+	glBindTexture(GL_TEXTURE_2D, baked_id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, resolution, resolution, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+
+	const int subdivisions[3] = { subdivisions_a, subdivisions_b, subdivisions_c };
+	if (cache && cache->load(false, resolution, persistance, subdivisions, seed)) {
+		std::cout << "[+] weather loaded from the cache in " << cache->time << " ms" << std::endl;
+		if (job) job->start(&texture_id, baked_id);
+		return;
+	}
+
+	if (cpu) {
+		std::vector<unsigned char> texels((size_t)resolution * resolution);
+		cpu->bake_plane(texels.data(), resolution, persistance, seed, subdivisions);
+		std::cout << "[+] weather baked on " << cpu->threads << " cpu threads in " << cpu->time << " ms" << std::endl;
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, resolution, resolution, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		if (cache) {
+			cache->store(false, resolution, persistance, subdivisions, seed, texels.data());
+		}
+		if (job) job->start(&texture_id, baked_id);
+		return;
+	}
+
+	// set shader variables, before every
+	// dispatch of a job
+	auto bind = [=]() {
+		compute->bind();
+		compute->set1i("clipmap", 0);
+		compute->set1i("output_texture", 0);
+		compute->set1i("resolution", resolution);
+		compute->set1f("persistance", persistance);
+		compute->set1i("subdivisions_a", subdivisions_a);
+		compute->set1i("subdivisions_b", subdivisions_b);
+		compute->set1i("subdivisions_c", subdivisions_c);
+		compute->set1i("seed", seed);
+		glBindImageTexture(0, baked_id, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R8);
+	};
+
+	// keep it on disk
+	auto finish = [=](bool baked) {
+		if (baked && cache) {
+			std::vector<unsigned char> texels((size_t)resolution * resolution);
+			glActiveTexture(GL_TEXTURE0 + baked_id);
+			glBindTexture(GL_TEXTURE_2D, baked_id);
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+			glPixelStorei(GL_PACK_ALIGNMENT, 4);
+			cache->store(false, resolution, persistance, subdivisions, seed, texels.data());
+		}
+	};
+
+	if (job) {
+		job->start(&texture_id, baked_id, compute, false, resolution, bind, finish);
+		return;
+	}
+
+	// dispatch compute shader
+	bind();
+	compute->set1i("slice_offset", 0);
+	glDispatchCompute(resolution / 8, resolution / 8, 1);
+
+	// wait till finished
+	glMemoryBarrier(GL_ALL_BARRIER_BITS);
+
+	finish(true);
+}
+
+void bake_noise_packed(unsigned int &texture_id, shader* compute, int resolution, int detail_repeat, float main_persistance, int main_subdivisions_a, int main_subdivisions_b, int main_subdivisions_c, float detail_persistance, int detail_subdivisions_a, int detail_subdivisions_b, int detail_subdivisions_c, int main_seed, int detail_seed) {
 	// first time generating texture
 	if (glIsTexture(texture_id)) {
 		glDeleteTextures(1, &texture_id);
-		std::cout << "[+] baking new noise texture" << std::endl;
+		std::cout << "[+] baking new packed noise texture" << std::endl;
 	}
 	glGenTextures(1, &texture_id);
 	glActiveTexture(GL_TEXTURE0 + texture_id);
@@ -1121,149 +2434,205 @@ void bake_noise_main(unsigned int &texture_id, shader* compute, int resolution,
 	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, resolution, resolution, resolution, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
-	glBindImageTexture(0, texture_id, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R8);
-
-	// lay random points per each cell in
-	// the grid.
-	// for each layer
-	glm::vec4* points_a = new glm::vec4[subdivisions_a * subdivisions_a * subdivisions_a];
-	glm::vec4* points_b = new glm::vec4[subdivisions_b * subdivisions_b * subdivisions_b];
-	glm::vec4* points_c = new glm::vec4[subdivisions_c * subdivisions_c * subdivisions_c];
-	compute_worley_grid(points_a, subdivisions_a);
-	compute_worley_grid(points_b, subdivisions_b);
-	compute_worley_grid(points_c, subdivisions_c);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, resolution, resolution, resolution, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindImageTexture(0, texture_id, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8);
 
 	// set shader variables
 	compute->bind();
 	compute->set1i("output_texture", 0);
 	compute->set1i("resolution", resolution);
-	compute->set1f("persistance", persistance);
-	compute->set1i("subdivisions_a", subdivisions_a);
-	compute->set1i("subdivisions_b", subdivisions_b);
-	compute->set1i("subdivisions_c", subdivisions_c);
+	compute->set1i("detail_repeat", detail_repeat);
+	compute->set1f("main_persistance", main_persistance);
+	compute->set1f("detail_persistance", detail_persistance);
+	compute->set3i("main_subdivisions", main_subdivisions_a, main_subdivisions_b, main_subdivisions_c);
+	compute->set3i("detail_subdivisions", detail_subdivisions_a, detail_subdivisions_b, detail_subdivisions_c);
+	compute->set1i("main_seed", main_seed);
+	compute->set1i("detail_seed", detail_seed);
 
-	// pass random points a to shader storage buffer object
-	unsigned int ssbo_a = 0;
-	glGenBuffers(1, &ssbo_a);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_a);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, 16 * subdivisions_a * subdivisions_a * subdivisions_a, points_a, GL_DYNAMIC_COPY);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ssbo_a);
-	delete[] points_a;
-
-	// pass random points b to shader storage buffer object
-	unsigned int ssbo_b = 0;
-	glGenBuffers(1, &ssbo_b);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_b);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, 16 * subdivisions_b * subdivisions_b * subdivisions_b, points_b, GL_DYNAMIC_COPY);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ssbo_b);
-	delete[] points_b;
-
-	// pass random points c to shader storage buffer object
-	unsigned int ssbo_c = 0;
-	glGenBuffers(1, &ssbo_c);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_c);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, 16 * subdivisions_c * subdivisions_c * subdivisions_c, points_c, GL_DYNAMIC_COPY);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, ssbo_c);
-	delete[] points_c;
-	
 	// dispatch compute shader
 	glDispatchCompute(resolution / 8, resolution / 8, resolution / 8);
 
 	// wait till finished
 	glMemoryBarrier(GL_ALL_BARRIER_BITS);
 
-	// delete buffers
-	glDeleteBuffers(1, &ssbo_a);
-	glDeleteBuffers(1, &ssbo_b);
-	glDeleteBuffers(1, &ssbo_c);
+	glBindTexture(GL_TEXTURE_3D, texture_id);
+	glGenerateMipmap(GL_TEXTURE_3D);
 }
 
-// ---- 2d worley FBM ---- //
-void bake_noise_weather(unsigned int &texture_id, shader* compute, int resolution, float persistance, int subdivisions_a, int subdivisions_b, int subdivisions_c) {
-	// first time generating texture
+// ---- weather max pyramid ---- //
+void bake_noise_weather_max(unsigned int &texture_id, unsigned int weather_texture_id, shader* compute, int resolution) {
 	if (glIsTexture(texture_id)) {
 		glDeleteTextures(1, &texture_id);
-		std::cout << "[+] baking new weather texture" << std::endl;
 	}
+	int levels = (int)std::log2(resolution) + 1;
 	glGenTextures(1, &texture_id);
 	glActiveTexture(GL_TEXTURE0 + texture_id);
 	glBindTexture(GL_TEXTURE_2D, texture_id);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, resolution, resolution, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
-	glBindImageTexture(0, texture_id, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R8);
-
-	// lay random points per each cell in
-	// the grid.
-	// for each layer
-	glm::vec4* points_a = new glm::vec4[subdivisions_a * subdivisions_a];
-	glm::vec4* points_b = new glm::vec4[subdivisions_b * subdivisions_b];
-	glm::vec4* points_c = new glm::vec4[subdivisions_c * subdivisions_c];
-	compute_worley_grid(points_a, subdivisions_a, true);
-	compute_worley_grid(points_b, subdivisions_b, true);
-	compute_worley_grid(points_c, subdivisions_c, true);
+	glTexStorage2D(GL_TEXTURE_2D, levels, GL_R8, resolution, resolution);
+
+	// level 0 is the weather map itself
+	glCopyImageSubData(weather_texture_id, GL_TEXTURE_2D, 0, 0, 0, 0, texture_id, GL_TEXTURE_2D, 0, 0, 0, 0, resolution, resolution, 1);
+
+	// each level keeps the max of the one below
+	compute->bind();
+	compute->set1i("input_level", 0);
+	compute->set1i("output_level", 1);
+	for (int level = 1; level < levels; ++level) {
+		int size = std::max(resolution >> level, 1);
+		glBindImageTexture(0, texture_id, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R8);
+		glBindImageTexture(1, texture_id, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+		glDispatchCompute((size + 7) / 8, (size + 7) / 8, 1);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+// ---- weather clipmap ---- //
+// every level is a layer of an array texture,
+// addressed toroidally: a texel of the plane
+// always lands on the same texel of its level,
+// so moving a level only bakes the rows and
+// columns it moved into.
+void bake_noise_weather_clipmap(unsigned int &texture_id, shader* compute, int resolution, int levels, float texel_size, int* centers, bool rebake, float center_u, float center_v, int seed, float persistance, int subdivisions_a, int subdivisions_b, int subdivisions_c) {
+	// first time generating texture
+	if (!glIsTexture(texture_id)) {
+		glGenTextures(1, &texture_id);
+		glActiveTexture(GL_TEXTURE0 + texture_id);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture_id);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R8, resolution, resolution, 8);
+		rebake = true;
+	}
 
-	// set shader variables
 	compute->bind();
+	compute->set1i("clipmap", 1);
 	compute->set1i("output_texture", 0);
 	compute->set1i("resolution", resolution);
+	compute->set1i("seed", seed);
 	compute->set1f("persistance", persistance);
 	compute->set1i("subdivisions_a", subdivisions_a);
 	compute->set1i("subdivisions_b", subdivisions_b);
 	compute->set1i("subdivisions_c", subdivisions_c);
 
-	// pass random points a to shader storage buffer object
-	unsigned int ssbo_a = 0;
-	glGenBuffers(1, &ssbo_a);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_a);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, 16 * subdivisions_a * subdivisions_a, points_a, GL_DYNAMIC_COPY);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ssbo_a);
-	delete[] points_a;
-
-	// pass random points b to shader storage buffer object
-	unsigned int ssbo_b = 0;
-	glGenBuffers(1, &ssbo_b);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_b);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, 16 * subdivisions_b * subdivisions_b, points_b, GL_DYNAMIC_COPY);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ssbo_b);
-	delete[] points_b;
-
-	// pass random points c to shader storage buffer object
-	unsigned int ssbo_c = 0;
-	glGenBuffers(1, &ssbo_c);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_c);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, 16 * subdivisions_c * subdivisions_c, points_c, GL_DYNAMIC_COPY);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, ssbo_c);
-	delete[] points_c;
-	
-	// dispatch compute shader
-	glDispatchCompute(resolution / 8, resolution / 8, 1);
+	// texels in [centre - half, centre + half)
+	int half = resolution / 2;
+	bool baked = false;
+	for (int level = 0; level < levels; ++level) {
+		int x = (int)std::floor(center_u / texel_size);
+		int y = (int)std::floor(center_v / texel_size);
+		int dx = x - centers[level * 2];
+		int dy = y - centers[level * 2 + 1];
+		// rectangles to bake as origin, size
+		std::vector<int> rectangles;
+		if (rebake || std::abs(dx) >= resolution || std::abs(dy) >= resolution) {
+			rectangles = { x - half, y - half, resolution, resolution };
+		} else {
+			if (dx != 0) {
+				int first = dx > 0 ? centers[level * 2] + half : x - half;
+				rectangles.insert(rectangles.end(), { first, y - half, std::abs(dx), resolution });
+			}
+			if (dy != 0) {
+				int first = dy > 0 ? centers[level * 2 + 1] + half : y - half;
+				rectangles.insert(rectangles.end(), { x - half, first, resolution, std::abs(dy) });
+			}
+		}
+		centers[level * 2] = x;
+		centers[level * 2 + 1] = y;
+		if (!rectangles.empty()) {
+			compute->set1f("clipmap_texel_size", texel_size);
+			glBindImageTexture(0, texture_id, 0, GL_FALSE, level, GL_WRITE_ONLY, GL_R8);
+			for (size_t i = 0; i < rectangles.size(); i += 4) {
+				compute->set2i("clipmap_origin", rectangles[i], rectangles[i + 1]);
+				compute->set2i("clipmap_size", rectangles[i + 2], rectangles[i + 3]);
+				glDispatchCompute((rectangles[i + 2] + 7) / 8, (rectangles[i + 3] + 7) / 8, 1);
+			}
+			baked = true;
+		}
+		texel_size *= 2.0f;
+	}
+	if (baked) {
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+}
 
-	// wait till finished
-	glMemoryBarrier(GL_ALL_BARRIER_BITS);
+// ---------------------------- //
+// -------- atmosphere -------- //
+// ---------------------------- //
 
-	// delete buffers
-	glDeleteBuffers(1, &ssbo_a);
-	glDeleteBuffers(1, &ssbo_b);
-	glDeleteBuffers(1, &ssbo_c);
+// ---- transmittance lut ---- //
+void bake_atmosphere_transmittance(unsigned int &texture_id, shader* compute) {
+	const int width = 256, height = 64;
+	glGenTextures(1, &texture_id);
+	glActiveTexture(GL_TEXTURE0 + texture_id);
+	glBindTexture(GL_TEXTURE_2D, texture_id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG32F, width, height);
+	glBindImageTexture(0, texture_id, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32F);
+
+	compute->bind();
+	compute->set1i("output_texture", 0);
+	glDispatchCompute(width / 8, height / 8, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
 }
 
-static void write_pixels_to_mat(cv::Mat& ref, int width, int height) {
-	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, ref.data);
-	cv::Mat pixels(height, width, CV_8UC3);
-	for( int y = 0; y < height; ++y) {
-		for(int x = 0; x < width; ++x) {
-			pixels.at<cv::Vec3b>(y, x)[2] = ref.at<cv::Vec3b>(height - y - 1, x)[0];
-			pixels.at<cv::Vec3b>(y, x)[1] = ref.at<cv::Vec3b>(height - y - 1, x)[1];
-			pixels.at<cv::Vec3b>(y, x)[0] = ref.at<cv::Vec3b>(height - y - 1, x)[2];
-		}
+// ---- sky view lut ---- //
+void bake_atmosphere_sky(unsigned int &texture_id, shader* compute, unsigned int transmittance_texture_id, float* light_direction, glm::vec3 camera_location) {
+	const int width = 256, height = 128;
+	// first time generating texture
+	if (!glIsTexture(texture_id)) {
+		glGenTextures(1, &texture_id);
+		glActiveTexture(GL_TEXTURE0 + texture_id);
+		glBindTexture(GL_TEXTURE_2D, texture_id);
+		// azimuth wraps around
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, width, height);
+	}
+	glBindImageTexture(0, texture_id, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+	compute->bind();
+	compute->set1i("output_texture", 0);
+	compute->set1i("transmittance_texture", transmittance_texture_id);
+	compute->set3f("camera_location", camera_location.x, camera_location.y, camera_location.z);
+	compute->set3f("light_direction", light_direction[0], light_direction[1], light_direction[2]);
+	glDispatchCompute(width / 8, height / 8, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+// bottom up bgr rows as read from opengl ->
+// top down, the way opencv wants them. the
+// swizzle was done by the read already.
+static void pixels_to_mat(const unsigned char* pixels, cv::Mat& ref, int width, int height) {
+	size_t row = width * 3;
+	for (int y = 0; y < height; ++y) {
+		std::memcpy(ref.ptr(y), pixels + (height - y - 1) * row, row);
+	}
+}
+
+static void read_noise_texture(unsigned int texture_id, int resolution, bool volume, cpu_renderer::noise_texture& noise) {
+	GLenum target = volume ? GL_TEXTURE_3D : GL_TEXTURE_2D;
+	std::vector<unsigned char> texels((size_t)resolution * resolution * (volume ? resolution : 1));
+	glActiveTexture(GL_TEXTURE0 + texture_id);
+	glBindTexture(target, texture_id);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTexImage(target, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+	noise.resolution = resolution;
+	noise.texels.resize(texels.size());
+	for (size_t i = 0; i < texels.size(); ++i) {
+		noise.texels[i] = texels[i] / 255.0f;
 	}
-	ref = pixels;
 }
 
 static void imgui_help_marker(const char* desc, bool warning) {
@@ -1276,3 +2645,171 @@ static void imgui_help_marker(const char* desc, bool warning) {
 		ImGui::EndTooltip();
 	}
 }
+
+// ----------------------- //
+// -------- light -------- //
+// ----------------------- //
+
+static void light_direction_from_time(float time, float* direction) {
+	direction[0] = 0.0f;
+	direction[1] = (time - 6.0f) / 6.0f;
+	direction[2] = direction[1] - 1.0f;
+	if (time > 12.0f) {
+		direction[1] = 2.0f - direction[1];
+	}
+}
+
+static void light_direction_normalize(float* direction, float* inverse) {
+	float module = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+	for (int i = 0; i < 3; ++i) {
+		direction[i] /= module;
+		inverse[i] = direction[i] == 0.0f ? 1.0f : 1.0f / direction[i];
+	}
+}
+
+// ------------------------------ //
+// -------- command line -------- //
+// ------------------------------ //
+
+static void bench_camera(int path, float t, const float* cloud_location, const float* cloud_volume, glm::vec3& location, float& pitch, float& yaw) {
+	// pitch 90 looks straight up
+	switch (path) {
+		case 0: // up, from the ground below
+			location = glm::vec3(cloud_location[0] + 20.0f * t, 0.0f, cloud_location[2]);
+			pitch = 90.0f - 20.0f * t;
+			yaw = 90.0f * t;
+			break;
+		case 1: // horizon, from the ground
+			location = glm::vec3(cloud_location[0], 0.0f, cloud_location[2]);
+			pitch = 10.0f * t;
+			yaw = 180.0f * t;
+			break;
+		case 2: // inside, turning around
+			location = glm::vec3(cloud_location[0] + 20.0f * t, cloud_location[1], cloud_location[2]);
+			pitch = 10.0f;
+			yaw = 360.0f * t;
+			break;
+		default: // above, looking down
+			location = glm::vec3(cloud_location[0], cloud_location[1] + cloud_volume[1] + 50.0f, cloud_location[2] + 20.0f * t);
+			pitch = 300.0f - 30.0f * t;
+			yaw = 90.0f * t;
+			break;
+	}
+}
+
+static void print_usage(const char* program) {
+	std::cout << "usage: " << program << " [options]" << std::endl
+		<< "  --headless              render without a window, write the image and exit" << std::endl
+		<< "  --preset <name>         cloud preset: cumulus, stratocumulus, stratus, altocumulus, cirrocumulus" << std::endl
+		<< "  --camera <x,y,z>        camera location" << std::endl
+		<< "  --angles <pitch,yaw>    camera angles in degrees" << std::endl
+		<< "  --time <hour>           time of the day, from 6 to 18" << std::endl
+		<< "  --resolution <w>x<h>    image size" << std::endl
+		<< "  --frames <n>            frames rendered before writing, headless only" << std::endl
+		<< "  --output <path>         image written by headless runs or video by sequences. the extension picks the format" << std::endl
+		<< "  --sequence <s,d,fps>    render d seconds of animation from second s at fps into a video, then exit" << std::endl
+		<< "  --tiles <size>          headless only. render the still in tiles of size^2, streamed to a .tif or .ppm" << std::endl
+		<< "  --trace <path>          write a chrome trace of every pass to path on exit" << std::endl
+		<< "  --bench <path>          headless only. time every preset, camera path and quality setting, write json" << std::endl
+		<< "                          --resolution limits it to one size, --frames sets the frames measured (60)" << std::endl
+		<< "  --cpu                   headless only. bake the noise and render the still on the cpu, as a reference" << std::endl
+		<< "  --threads <n>           threads of the cpu renderer and noise baker, one per core by default" << std::endl
+		<< "  --seed <n>              seed of the noise and wind, 1 by default. baked noise is" << std::endl
+		<< "                          cached in ./cache/ by seed and settings, so repeated runs skip the bake" << std::endl;
+}
+
+static bool parse_options(int argc, char* argv[], options& o) {
+	bool output = false;
+	for (int i = 1; i < argc; ++i) {
+		std::string option = argv[i];
+		if (option == "--help" || option == "-h") {
+			print_usage(argv[0]);
+			return false;
+		}
+		if (option == "--headless") {
+			o.headless = true;
+			continue;
+		}
+		if (option == "--cpu") {
+			o.cpu = true;
+			continue;
+		}
+		// the rest take a value
+		static const char* valued[] = { "--preset", "--camera", "--angles", "--time", "--resolution", "--frames", "--output", "--sequence", "--tiles", "--trace", "--bench", "--threads", "--seed" };
+		bool known = false;
+		for (const char* name : valued) {
+			known |= option == name;
+		}
+		if (!known) {
+			std::cout << "[-] Unknown option " << option << std::endl;
+			print_usage(argv[0]);
+			return false;
+		}
+		if (i + 1 >= argc) {
+			std::cout << "[-] Missing value for " << option << std::endl;
+			print_usage(argv[0]);
+			return false;
+		}
+		const char* value = argv[++i];
+		bool valid = true;
+		if (option == "--preset") {
+			valid = false;
+			for (int n = 0; n < IM_ARRAYSIZE(cloud_models); ++n) {
+				if (std::strcmp(value, cloud_models[n]) == 0) {
+					o.preset = n;
+					valid = true;
+				}
+			}
+		} else if (option == "--camera") {
+			valid = std::sscanf(value, "%f,%f,%f", &o.camera_location[0], &o.camera_location[1], &o.camera_location[2]) == 3;
+		} else if (option == "--angles") {
+			valid = std::sscanf(value, "%f,%f", &o.camera_pitch, &o.camera_yaw) == 2;
+		} else if (option == "--time") {
+			valid = std::sscanf(value, "%f", &o.time) == 1 && o.time >= 6.0f && o.time <= 18.0f;
+		} else if (option == "--resolution") {
+			valid = std::sscanf(value, "%dx%d", &o.resolution[0], &o.resolution[1]) == 2 && o.resolution[0] > 0 && o.resolution[1] > 0;
+			o.resolution_set = true;
+		} else if (option == "--frames") {
+			valid = std::sscanf(value, "%d", &o.frames) == 1 && o.frames > 0;
+			o.frames_set = true;
+		} else if (option == "--output") {
+			o.output = value;
+			output = true;
+		} else if (option == "--sequence") {
+			valid = std::sscanf(value, "%f,%f,%d", &o.sequence_start, &o.sequence_duration, &o.sequence_fps) == 3
+				&& o.sequence_start >= 0.0f && o.sequence_duration > 0.0f && o.sequence_fps > 0;
+		} else if (option == "--trace") {
+			o.trace = value;
+		} else if (option == "--bench") {
+			o.bench = value;
+		} else if (option == "--threads") {
+			valid = std::sscanf(value, "%d", &o.threads) == 1 && o.threads >= 0;
+		} else if (option == "--seed") {
+			valid = std::sscanf(value, "%d", &o.seed) == 1 && o.seed >= 0;
+		} else if (option == "--tiles") {
+			valid = std::sscanf(value, "%d", &o.tiles) == 1 && o.tiles >= 64;
+		}
+		if (!valid) {
+			std::cout << "[-] Invalid value " << value << " for " << option << std::endl;
+			return false;
+		}
+	}
+	if (o.tiles > 0 && !o.headless) {
+		std::cout << "[-] --tiles needs --headless" << std::endl;
+		return false;
+	}
+	if (!o.bench.empty() && !o.headless) {
+		std::cout << "[-] --bench needs --headless" << std::endl;
+		return false;
+	}
+	if (o.cpu && (!o.headless || o.tiles > 0 || o.sequence_fps > 0 || !o.bench.empty())) {
+		std::cout << "[-] --cpu renders headless stills only" << std::endl;
+		return false;
+	}
+	if (o.sequence_fps > 0 && !output) {
+		o.output = "ao_video.avi";
+	} else if (o.tiles > 0 && !output) {
+		o.output = "ao_image.tif";
+	}
+	return true;
+}
@@ -0,0 +1,117 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#include <algorithm>
+#include <GL/glew.h>
+#include "bake_job.h"
+
+bake_job::bake_job(float budget) :
+	budget(budget),
+	progress(0.0f),
+	target(nullptr),
+	texture_id(0),
+	compute(nullptr),
+	volume(false),
+	resolution(0),
+	running(false),
+	slice(0),
+	slices(8),
+	fence(nullptr) {
+	glGenQueries(2, queries);
+}
+
+bake_job::~bake_job() {
+	cancel();
+	glDeleteQueries(2, queries);
+}
+
+void bake_job::start(unsigned int* target, unsigned int texture_id, shader* compute, bool volume, int resolution,
+		std::function<void()> bind, std::function<void(bool)> finish) {
+	cancel();
+	this->target = target;
+	this->texture_id = texture_id;
+	this->compute = compute;
+	this->volume = volume;
+	this->resolution = compute ? resolution : 0;
+	this->bind = bind;
+	this->finish = finish;
+	running = true;
+	slice = 0;
+	slices = 8;
+	progress = compute ? 0.0f : 1.0f;
+}
+
+bool bake_job::step() {
+	if (!running) {
+		return false;
+	}
+	if (fence) {
+		GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			return false;
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+		// fit the next chunk to the budget, at
+		// most twice or half the last one
+		GLuint64 begin, end;
+		glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+		float time = (end - begin) / 1000000.0f;
+		if (time > 0.0f) {
+			int fit = (int)(slices * budget / time) / 8 * 8;
+			int lower = std::max(8, slices / 2 / 8 * 8);
+			int upper = std::max(8, std::min(slices * 2, resolution));
+			slices = std::max(lower, std::min(fit, upper));
+		}
+		progress = (float)slice / resolution;
+	}
+
+	if (slice >= resolution) {
+		if (finish) finish(true);
+		if (glIsTexture(*target)) {
+			glDeleteTextures(1, target);
+		}
+		*target = texture_id;
+		texture_id = 0;
+		running = false;
+		progress = 1.0f;
+		return true;
+	}
+
+	int count = std::min(slices, resolution - slice);
+	bind();
+	compute->set1i("slice_offset", slice);
+	glQueryCounter(queries[0], GL_TIMESTAMP);
+	if (volume) {
+		glDispatchCompute(resolution / 8, resolution / 8, count / 8);
+	} else {
+		glDispatchCompute(resolution / 8, count / 8, 1);
+	}
+	glQueryCounter(queries[1], GL_TIMESTAMP);
+	glMemoryBarrier(GL_ALL_BARRIER_BITS);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slice += count;
+	return false;
+}
+
+void bake_job::cancel() {
+	if (!running) {
+		return;
+	}
+	if (fence) {
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (finish) finish(false);
+	glDeleteTextures(1, &texture_id);
+	texture_id = 0;
+	running = false;
+	progress = 0.0f;
+}
+
+bool bake_job::busy() {
+	return running;
+}
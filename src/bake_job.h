@@ -0,0 +1,64 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#pragma once
+
+#include <functional>
+#include "shader.h"
+
+typedef struct __GLsync *GLsync;
+
+// a compute bake spread over frames. slices
+// of a texture (z of a volume, rows of a
+// plane) are dispatched in chunks of 8, as
+// many a frame as fit in the time budget,
+// into a texture of its own. each chunk is
+// fenced, the next waits for it. once the
+// last one is done the texture replaces the
+// one being sampled, which is sampled
+// meanwhile.
+class bake_job {
+	public:
+		// ms of gpu time a frame gives the bake
+		float budget;
+		// slices baked, 0 - 1
+		float progress;
+
+		bake_job(float budget = 2.0f);
+		~bake_job();
+
+		// bakes texture_id, which replaces *target
+		// when done. bind sets compute up for a
+		// dispatch, then the job sets its
+		// slice_offset uniform. finish gets true
+		// before the swap, false if the bake is
+		// cancelled. without compute, texture_id is
+		// already baked and swapped on the next
+		// step.
+		void start(unsigned int* target, unsigned int texture_id, shader* compute = nullptr, bool volume = false, int resolution = 0,
+				std::function<void()> bind = nullptr, std::function<void(bool)> finish = nullptr);
+		// once a frame. true on the frame the
+		// texture is swapped in
+		bool step();
+		// drops the bake and its texture
+		void cancel();
+		bool busy();
+
+	private:
+		unsigned int* target;
+		unsigned int texture_id;
+		shader* compute;
+		bool volume;
+		int resolution;
+		std::function<void()> bind;
+		std::function<void(bool)> finish;
+		bool running;
+		// next slice and slices a chunk
+		int slice;
+		int slices;
+		GLsync fence;
+		// timestamps around the last chunk
+		unsigned int queries[2];
+};
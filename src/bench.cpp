@@ -0,0 +1,61 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include "bench.h"
+#include "json.h"
+
+// nearest rank
+static float percentile(const std::vector<float>& sorted, float p) {
+	int rank = (int)std::ceil(p / 100.0f * sorted.size());
+	return sorted[std::max(0, std::min((int)sorted.size() - 1, rank - 1))];
+}
+
+void bench_report::add(configuration c, std::vector<float>& frame_times) {
+	std::sort(frame_times.begin(), frame_times.end());
+	double sum = 0.0;
+	for (float t : frame_times) {
+		sum += t;
+	}
+	c.frames = frame_times.size();
+	c.mean = frame_times.empty() ? 0.0f : sum / frame_times.size();
+	c.p50 = frame_times.empty() ? 0.0f : percentile(frame_times, 50.0f);
+	c.p95 = frame_times.empty() ? 0.0f : percentile(frame_times, 95.0f);
+	c.p99 = frame_times.empty() ? 0.0f : percentile(frame_times, 99.0f);
+	configurations.push_back(c);
+}
+
+bool bench_report::write(const std::string& path, const std::string& renderer, int warmup) {
+	std::ofstream file(path);
+	if (!file) {
+		std::cout << "[-] Couldn't write " << path << std::endl;
+		return false;
+	}
+	file.precision(4);
+	file << std::fixed;
+	file << "{" << std::endl;
+	file << "\t\"renderer\": \"" << json_escape(renderer) << "\"," << std::endl;
+	file << "\t\"warmup\": " << warmup << "," << std::endl;
+	file << "\t\"bakes\": {";
+	for (size_t i = 0; i < bakes.size(); ++i) {
+		file << (i ? ", " : "") << "\"" << json_escape(bakes[i].first) << "\": " << bakes[i].second;
+	}
+	file << "}," << std::endl;
+	file << "\t\"configurations\": [" << std::endl;
+	for (size_t i = 0; i < configurations.size(); ++i) {
+		const configuration& c = configurations[i];
+		file << "\t\t{ \"name\": \"" << json_escape(c.name) << "\", \"preset\": \"" << json_escape(c.preset) << "\", \"path\": \"" << json_escape(c.path) << "\""
+			<< ", \"volume_samples\": " << c.volume_samples << ", \"in_scatter_samples\": " << c.in_scatter_samples
+			<< ", \"resolution\": [" << c.resolution[0] << ", " << c.resolution[1] << "], \"frames\": " << c.frames
+			<< ", \"mean\": " << c.mean << ", \"p50\": " << c.p50 << ", \"p95\": " << c.p95 << ", \"p99\": " << c.p99 << " }"
+			<< (i + 1 < configurations.size() ? "," : "") << std::endl;
+	}
+	file << "\t]" << std::endl;
+	file << "}" << std::endl;
+	return (bool)file;
+}
@@ -0,0 +1,38 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// frame time statistics of a benchmark run,
+// written as json for tools/bench_compare.py.
+// every configuration has a unique name the
+// comparison matches runs by.
+class bench_report {
+	public:
+		struct configuration {
+			std::string name;
+			std::string preset;
+			std::string path;
+			int volume_samples;
+			int in_scatter_samples;
+			int resolution[2];
+			int frames;
+			// ms
+			float mean;
+			float p50;
+			float p95;
+			float p99;
+		};
+		std::vector<configuration> configurations;
+		// noise bake time of each preset, ms
+		std::vector<std::pair<std::string, float>> bakes;
+
+		// frame_times in ms. sorted in place.
+		void add(configuration c, std::vector<float>& frame_times);
+		bool write(const std::string& path, const std::string& renderer, int warmup);
+};
@@ -0,0 +1,669 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "cpu_renderer.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RENDERER_AVX2
+#include <immintrin.h>
+#endif
+
+typedef cpu_renderer::noise_texture noise_texture;
+
+// what every sample of a frame reads
+struct scene {
+	const parameters* p;
+	const noise_texture* main;
+	const noise_texture* weather;
+	const noise_texture* detail;
+	float time;
+	glm::vec3 camera_location;
+	glm::vec3 lower_bound;
+	glm::vec3 upper_bound;
+	glm::vec3 light_direction;
+	glm::vec3 inverse_light_direction;
+};
+
+// ---- atmosphere ---- constants ---- //
+// same as data/atmosphere.glsl
+static const int SCATTER_IN_STEP = 16;
+static const int SCATTER_DEPTH_STEP = 4;
+static const float radius_surface = 6360e3f;
+static const float radius_atmosphere = 6380e3f;
+static const float sun_intensity = 10.0f;
+static const glm::vec3 rayleigh_coefficient(58e-7f, 135e-7f, 331e-7f);
+static const float mie_coefficient_upper = 2e-5f;
+static const float mie_coefficient_lower = mie_coefficient_upper * 1.1f;
+static const glm::vec3 earth_center(0.0f, -radius_surface, 0.0f);
+
+// ---------------------------- //
+// -------- one by one -------- //
+// ---------------------------- //
+
+// the shader's functions, line by line
+
+static int wrap(int i, int n) {
+	return ((i % n) + n) % n;
+}
+
+// trilinear, repeating -> GL_LINEAR, GL_REPEAT
+static float sample_volume(const noise_texture& noise, glm::vec3 location) {
+	int n = noise.resolution;
+	glm::vec3 texel = location * (float)n - 0.5f;
+	glm::vec3 base = glm::floor(texel);
+	glm::vec3 f = texel - base;
+	int x[2] = { wrap((int)base.x, n), wrap((int)base.x + 1, n) };
+	int y[2] = { wrap((int)base.y, n), wrap((int)base.y + 1, n) };
+	int z[2] = { wrap((int)base.z, n), wrap((int)base.z + 1, n) };
+	const float* t = noise.texels.data();
+	float c[2][2];
+	for (int k = 0; k < 2; ++k) {
+		for (int j = 0; j < 2; ++j) {
+			const float* row = t + ((size_t)z[k] * n + y[j]) * n;
+			c[k][j] = row[x[0]] + (row[x[1]] - row[x[0]]) * f.x;
+		}
+	}
+	float c0 = c[0][0] + (c[0][1] - c[0][0]) * f.y;
+	float c1 = c[1][0] + (c[1][1] - c[1][0]) * f.y;
+	return c0 + (c1 - c0) * f.z;
+}
+
+// nearest, repeating -> GL_NEAREST, GL_REPEAT
+static float sample_weather(const noise_texture& noise, glm::vec2 location) {
+	int n = noise.resolution;
+	int x = wrap((int)std::floor(location.x * n), n);
+	int y = wrap((int)std::floor(location.y * n), n);
+	return noise.texels[(size_t)y * n + x];
+}
+
+static glm::vec2 ray_to_cloud(glm::vec3 origin, glm::vec3 inverted_direction, glm::vec3 vol_left_bound, glm::vec3 vol_right_bound) {
+	glm::vec3 t0 = (vol_left_bound - origin) * inverted_direction;
+	glm::vec3 t1 = (vol_right_bound - origin) * inverted_direction;
+	glm::vec3 tmin = glm::min(t0, t1);
+	glm::vec3 tmax = glm::max(t0, t1);
+	float dist_maxmin = std::max(std::max(tmin.x, tmin.y), tmin.z);
+	float dist_minmax = std::min(tmax.x, std::min(tmax.y, tmax.z));
+	float dist_to_volume = std::max(0.0f, dist_maxmin);
+	float dist_across_volume = std::max(0.0f, dist_minmax - dist_to_volume);
+	return glm::vec2(dist_to_volume, dist_across_volume);
+}
+
+static float mie_coverage(const scene& s, glm::vec3 position) {
+	const parameters& p = *s.p;
+	float fade = p.cloud_volume_edge_fade_distance;
+	float distance_edge_x = std::min(fade, std::min(position.x - s.lower_bound.x, s.upper_bound.x - position.x));
+	float distance_edge_z = std::min(fade, std::min(position.z - s.lower_bound.z, s.upper_bound.z - position.z));
+	float edge_weight = std::min(distance_edge_x, distance_edge_z) / fade;
+	float h = (position.y - s.lower_bound.y) / (2.0f * p.cloud_volume[1]);
+	float height = 1.0f - h * h * h * h;
+	glm::vec2 weather_sample_location(
+		position.x / p.noise_weather_scale + p.noise_weather_offset[0] + p.wind_vector[0] * p.wind_weather_weight * s.time,
+		position.z / p.noise_weather_scale + p.noise_weather_offset[1] + p.wind_vector[2] * p.wind_weather_weight * s.time);
+	float weather = std::max(sample_weather(*s.weather, weather_sample_location), 0.0f);
+	weather = std::max(weather - p.cloud_density_threshold, 0.0f);
+	return height * weather * edge_weight;
+}
+
+static float mie_density(const scene& s, glm::vec3 position) {
+	const parameters& p = *s.p;
+	glm::vec3 wind(p.wind_vector[0], p.wind_vector[1], p.wind_vector[2]);
+	glm::vec3 main_sample_location = position / p.noise_main_scale + glm::vec3(p.noise_main_offset[0], p.noise_main_offset[1], p.noise_main_offset[2]) + wind * p.wind_main_weight * s.time;
+	float main_noise_fbm = sample_volume(*s.main, main_sample_location);
+	float density = std::max(0.0f, main_noise_fbm * mie_coverage(s, position) - p.cloud_density_threshold);
+	if (density > 0.0f) {
+		glm::vec3 detail_sample_location = position / p.noise_detail_scale + glm::vec3(p.noise_detail_offset[0], p.noise_detail_offset[1], p.noise_detail_offset[2]) + wind * p.wind_detail_weight * s.time;
+		density -= sample_volume(*s.detail, detail_sample_location) * p.noise_detail_weight;
+		return std::max(0.0f, density * p.cloud_density_multiplier);
+	}
+	return 0.0f;
+}
+
+static float henyey_greenstein(float g, float angle_cos) {
+	float g2 = g * g;
+	return (1.0f - g2) / std::pow(1.0f + g2 - 2.0f * g * angle_cos, 1.5f);
+}
+
+static float mie_light_depth(const scene& s, glm::vec3 position) {
+	const parameters& p = *s.p;
+	float distance_inside_volume = ray_to_cloud(position, s.inverse_light_direction, s.lower_bound, s.upper_bound).y;
+	distance_inside_volume = std::min(p.render_shadowing_max_distance, distance_inside_volume);
+	float step_size = distance_inside_volume / (float)p.render_in_scatter_samples;
+	float total_density = 0.0f;
+	for (int i = 0; i < p.render_in_scatter_samples; ++i) {
+		total_density += mie_density(s, position) * step_size;
+		position += s.light_direction * step_size;
+	}
+	return total_density;
+}
+
+static float mie_in_scatter(const scene& s, glm::vec3 position) {
+	const parameters& p = *s.p;
+	float total_density = mie_light_depth(s, position);
+	return (1.0f - p.render_shadowing_weight) + std::exp(-total_density * p.cloud_absorption) * p.render_shadowing_weight;
+}
+
+// accumulated light and transmittance
+static glm::vec4 cloud_march(const scene& s, glm::vec3 direction) {
+	const parameters& p = *s.p;
+	float radiance = 1.0f;
+	float color_cloud = 0.0f;
+	glm::vec2 march = ray_to_cloud(s.camera_location, 1.0f / direction, s.lower_bound, s.upper_bound);
+	float distance_per_step = march.y / p.render_volume_samples;
+	float hg_constant = henyey_greenstein(0.2f, glm::dot(direction, s.light_direction));
+	for (float distance_travelled = 0.0f; distance_travelled < march.y; distance_travelled += distance_per_step) {
+		glm::vec3 ray_position = s.camera_location + direction * (march.x + distance_travelled);
+		float density = mie_density(s, ray_position);
+		radiance *= std::exp(-density * distance_per_step);
+		if (radiance < 0.01f) break;
+		// nothing to light, the shader adds zero
+		if (density == 0.0f) continue;
+		float in_light = mie_in_scatter(s, ray_position);
+		color_cloud += density * distance_per_step * in_light * radiance * hg_constant;
+	}
+	return glm::vec4(glm::vec3(color_cloud), radiance);
+}
+
+static glm::vec2 atmosphere_density(glm::vec3 point) {
+	float h = std::max(0.0f, glm::length(point - earth_center) - radius_surface);
+	return glm::vec2(std::exp(-h / 8e3f), std::exp(-h / 12e2f));
+}
+
+static float atmosphere_march(glm::vec3 origin, glm::vec3 direction, float radius) {
+	glm::vec3 v = origin - earth_center;
+	float b = glm::dot(v, direction);
+	float d = b * b - glm::dot(v, v) + radius * radius;
+	if (d < 0.0f) return -1.0f;
+	d = std::sqrt(d);
+	float r1 = -b - d, r2 = -b + d;
+	return (r1 >= 0.0f) ? r1 : r2;
+}
+
+static glm::vec2 atmosphere_light_depth(glm::vec3 point, glm::vec3 light_direction) {
+	float l_sde = atmosphere_march(point, light_direction, radius_atmosphere);
+	glm::vec2 depth_accumulation(0.0f);
+	l_sde /= SCATTER_DEPTH_STEP;
+	glm::vec3 direction_sde = light_direction * l_sde;
+	for (int j = 0; j < SCATTER_DEPTH_STEP; ++j) {
+		depth_accumulation += atmosphere_density(point + direction_sde * (float)j);
+	}
+	return depth_accumulation * l_sde;
+}
+
+static glm::vec3 atmosphere_scatter(glm::vec3 origin, glm::vec3 direction, float l, glm::vec3 light_direction) {
+	glm::vec2 total_depth(0.0f);
+	glm::vec3 intensity_rayleigh(0.0f);
+	glm::vec3 intensity_mie(0.0f);
+	float l_sin = l / SCATTER_IN_STEP;
+	glm::vec3 direction_sin = direction * l_sin;
+	for (int i = 0; i < SCATTER_IN_STEP; ++i) {
+		glm::vec3 point = origin + direction_sin * (float)i;
+		glm::vec2 depth = atmosphere_density(point) * l_sin;
+		total_depth += depth;
+		glm::vec2 depth_sum = total_depth + atmosphere_light_depth(point, light_direction);
+		glm::vec3 a = glm::exp(-rayleigh_coefficient * depth_sum.x - mie_coefficient_upper * depth_sum.y);
+		intensity_rayleigh += a * depth.x;
+		intensity_mie += a * depth.y;
+	}
+	float mu = glm::dot(direction, light_direction);
+	return glm::sqrt(sun_intensity * (1.0f + mu * mu) * (intensity_rayleigh * rayleigh_coefficient * 0.0597f + intensity_mie * mie_coefficient_lower * 0.0196f / std::pow(1.58f - 1.52f * mu, 1.5f)));
+}
+
+static glm::vec3 sky_color(const scene& s, glm::vec3 direction) {
+	const parameters& p = *s.p;
+	if (p.render_sky) {
+		float l = atmosphere_march(s.camera_location, direction, radius_atmosphere);
+		return atmosphere_scatter(s.camera_location, direction, l, s.light_direction);
+	}
+	return glm::vec3(p.background_color[0], p.background_color[1], p.background_color[2]);
+}
+
+// data/camera.glsl
+static glm::vec3 ray_direction(glm::vec2 pixel, glm::vec2 size, const glm::mat4& view_matrix) {
+	glm::vec2 uv = pixel / size * 2.0f - 1.0f;
+	uv.x *= size.x / size.y;
+	glm::vec4 dir(glm::normalize(glm::vec3(uv, -2.0f)), 1.0f);
+	return glm::vec3(view_matrix * dir);
+}
+
+// as the framebuffer stores it
+static unsigned char unorm8(float value) {
+	return (unsigned char)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+static void store_pixel(unsigned char* pixel, glm::vec3 color, bool bgr) {
+	pixel[bgr ? 2 : 0] = unorm8(color.r);
+	pixel[1] = unorm8(color.g);
+	pixel[bgr ? 0 : 2] = unorm8(color.b);
+}
+
+// ------------------------------ //
+// -------- packets of 8 -------- //
+// ------------------------------ //
+
+// the same functions on 8 rays at once. lanes
+// that are done are masked out until every
+// ray in the packet is.
+
+#ifdef CPU_RENDERER_AVX2
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+struct vec8 {
+	__m256 x, y, z;
+};
+
+static inline __m256 set8(float value) {
+	return _mm256_set1_ps(value);
+}
+
+static inline __m256 min8(__m256 a, __m256 b) {
+	return _mm256_min_ps(a, b);
+}
+
+static inline __m256 max8(__m256 a, __m256 b) {
+	return _mm256_max_ps(a, b);
+}
+
+// mask ? a : b
+static inline __m256 select8(__m256 mask, __m256 a, __m256 b) {
+	return _mm256_blendv_ps(b, a, mask);
+}
+
+static inline __m256 dot8(const vec8& a, const vec8& b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline vec8 mad8(const vec8& a, const vec8& b, __m256 t) {
+	return { a.x + b.x * t, a.y + b.y * t, a.z + b.z * t };
+}
+
+// cephes' expf
+static inline __m256 exp8(__m256 x) {
+	x = min8(max8(x, set8(-88.3762626647949f)), set8(88.3762626647949f));
+	__m256 fx = _mm256_floor_ps(x * set8(1.44269504088896341f) + set8(0.5f));
+	x = x - fx * set8(0.693359375f) - fx * set8(-2.12194440e-4f);
+	__m256 y = set8(1.9875691500e-4f);
+	y = y * x + set8(1.3981999507e-3f);
+	y = y * x + set8(8.3334519073e-3f);
+	y = y * x + set8(4.1665795894e-2f);
+	y = y * x + set8(1.6666665459e-1f);
+	y = y * x + set8(5.0000001201e-1f);
+	y = y * (x * x) + x + set8(1.0f);
+	__m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(fx), _mm256_set1_epi32(127)), 23);
+	return y * _mm256_castsi256_ps(exponent);
+}
+
+// texel index in [0, n) of a floored
+// coordinate. clamped too, so lanes holding
+// garbage still read inside the texture.
+static inline __m256i wrap8(__m256 base, float n) {
+	__m256 wrapped = base - set8(n) * _mm256_floor_ps(base / set8(n));
+	__m256i i = _mm256_cvttps_epi32(wrapped);
+	return _mm256_max_epi32(_mm256_min_epi32(i, _mm256_set1_epi32((int)n - 1)), _mm256_setzero_si256());
+}
+
+static inline __m256i wrap_next8(__m256i i, int n) {
+	__m256i next = _mm256_add_epi32(i, _mm256_set1_epi32(1));
+	return _mm256_andnot_si256(_mm256_cmpeq_epi32(next, _mm256_set1_epi32(n)), next);
+}
+
+static inline __m256 sample_volume8(const noise_texture& noise, const vec8& location) {
+	int n = noise.resolution;
+	__m256 size = set8((float)n);
+	__m256 tx = location.x * size - set8(0.5f);
+	__m256 ty = location.y * size - set8(0.5f);
+	__m256 tz = location.z * size - set8(0.5f);
+	__m256 bx = _mm256_floor_ps(tx), by = _mm256_floor_ps(ty), bz = _mm256_floor_ps(tz);
+	__m256 fx = tx - bx, fy = ty - by, fz = tz - bz;
+	__m256i x0 = wrap8(bx, n), y0 = wrap8(by, n), z0 = wrap8(bz, n);
+	__m256i x1 = wrap_next8(x0, n), y1 = wrap_next8(y0, n), z1 = wrap_next8(z0, n);
+	__m256i stride = _mm256_set1_epi32(n);
+	const float* t = noise.texels.data();
+	__m256 c[2][2];
+	__m256i zs[2] = { z0, z1 };
+	__m256i ys[2] = { y0, y1 };
+	for (int k = 0; k < 2; ++k) {
+		for (int j = 0; j < 2; ++j) {
+			__m256i row = _mm256_mullo_epi32(_mm256_add_epi32(_mm256_mullo_epi32(zs[k], stride), ys[j]), stride);
+			__m256 a = _mm256_i32gather_ps(t, _mm256_add_epi32(row, x0), 4);
+			__m256 b = _mm256_i32gather_ps(t, _mm256_add_epi32(row, x1), 4);
+			c[k][j] = a + (b - a) * fx;
+		}
+	}
+	__m256 c0 = c[0][0] + (c[0][1] - c[0][0]) * fy;
+	__m256 c1 = c[1][0] + (c[1][1] - c[1][0]) * fy;
+	return c0 + (c1 - c0) * fz;
+}
+
+static inline __m256 sample_weather8(const noise_texture& noise, __m256 u, __m256 v) {
+	int n = noise.resolution;
+	__m256i x = wrap8(_mm256_floor_ps(u * set8((float)n)), n);
+	__m256i y = wrap8(_mm256_floor_ps(v * set8((float)n)), n);
+	__m256i index = _mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_set1_epi32(n)), x);
+	return _mm256_i32gather_ps(noise.texels.data(), index, 4);
+}
+
+// x -> distance to, y -> distance across
+static inline void ray_to_cloud8(const vec8& origin, const vec8& inverted_direction, glm::vec3 lower, glm::vec3 upper, __m256& to, __m256& across) {
+	__m256 t0x = (set8(lower.x) - origin.x) * inverted_direction.x;
+	__m256 t0y = (set8(lower.y) - origin.y) * inverted_direction.y;
+	__m256 t0z = (set8(lower.z) - origin.z) * inverted_direction.z;
+	__m256 t1x = (set8(upper.x) - origin.x) * inverted_direction.x;
+	__m256 t1y = (set8(upper.y) - origin.y) * inverted_direction.y;
+	__m256 t1z = (set8(upper.z) - origin.z) * inverted_direction.z;
+	__m256 dist_maxmin = max8(max8(min8(t0x, t1x), min8(t0y, t1y)), min8(t0z, t1z));
+	__m256 dist_minmax = min8(max8(t0x, t1x), min8(max8(t0y, t1y), max8(t0z, t1z)));
+	to = max8(set8(0.0f), dist_maxmin);
+	across = max8(set8(0.0f), dist_minmax - to);
+}
+
+static inline __m256 mie_coverage8(const scene& s, const vec8& position) {
+	const parameters& p = *s.p;
+	__m256 fade = set8(p.cloud_volume_edge_fade_distance);
+	__m256 distance_edge_x = min8(fade, min8(position.x - set8(s.lower_bound.x), set8(s.upper_bound.x) - position.x));
+	__m256 distance_edge_z = min8(fade, min8(position.z - set8(s.lower_bound.z), set8(s.upper_bound.z) - position.z));
+	__m256 edge_weight = min8(distance_edge_x, distance_edge_z) / fade;
+	__m256 h = (position.y - set8(s.lower_bound.y)) / set8(2.0f * p.cloud_volume[1]);
+	__m256 h2 = h * h;
+	__m256 height = set8(1.0f) - h2 * h2;
+	__m256 u = position.x / set8(p.noise_weather_scale) + set8(p.noise_weather_offset[0] + p.wind_vector[0] * p.wind_weather_weight * s.time);
+	__m256 v = position.z / set8(p.noise_weather_scale) + set8(p.noise_weather_offset[1] + p.wind_vector[2] * p.wind_weather_weight * s.time);
+	__m256 weather = max8(sample_weather8(*s.weather, u, v), set8(0.0f));
+	weather = max8(weather - set8(p.cloud_density_threshold), set8(0.0f));
+	return height * weather * edge_weight;
+}
+
+static inline __m256 mie_density8(const scene& s, const vec8& position) {
+	const parameters& p = *s.p;
+	vec8 main_sample_location = {
+		position.x / set8(p.noise_main_scale) + set8(p.noise_main_offset[0] + p.wind_vector[0] * p.wind_main_weight * s.time),
+		position.y / set8(p.noise_main_scale) + set8(p.noise_main_offset[1] + p.wind_vector[1] * p.wind_main_weight * s.time),
+		position.z / set8(p.noise_main_scale) + set8(p.noise_main_offset[2] + p.wind_vector[2] * p.wind_main_weight * s.time)
+	};
+	__m256 main_noise_fbm = sample_volume8(*s.main, main_sample_location);
+	__m256 density = max8(set8(0.0f), main_noise_fbm * mie_coverage8(s, position) - set8(p.cloud_density_threshold));
+	__m256 cloud = _mm256_cmp_ps(density, set8(0.0f), _CMP_GT_OQ);
+	if (_mm256_movemask_ps(cloud) == 0) {
+		return set8(0.0f);
+	}
+	vec8 detail_sample_location = {
+		position.x / set8(p.noise_detail_scale) + set8(p.noise_detail_offset[0] + p.wind_vector[0] * p.wind_detail_weight * s.time),
+		position.y / set8(p.noise_detail_scale) + set8(p.noise_detail_offset[1] + p.wind_vector[1] * p.wind_detail_weight * s.time),
+		position.z / set8(p.noise_detail_scale) + set8(p.noise_detail_offset[2] + p.wind_vector[2] * p.wind_detail_weight * s.time)
+	};
+	density = density - sample_volume8(*s.detail, detail_sample_location) * set8(p.noise_detail_weight);
+	density = max8(set8(0.0f), density * set8(p.cloud_density_multiplier));
+	return _mm256_and_ps(cloud, density);
+}
+
+static inline __m256 mie_light_depth8(const scene& s, vec8 position) {
+	const parameters& p = *s.p;
+	vec8 inverse_light = { set8(s.inverse_light_direction.x), set8(s.inverse_light_direction.y), set8(s.inverse_light_direction.z) };
+	vec8 light = { set8(s.light_direction.x), set8(s.light_direction.y), set8(s.light_direction.z) };
+	__m256 to, distance_inside_volume;
+	ray_to_cloud8(position, inverse_light, s.lower_bound, s.upper_bound, to, distance_inside_volume);
+	distance_inside_volume = min8(set8(p.render_shadowing_max_distance), distance_inside_volume);
+	__m256 step_size = distance_inside_volume / set8((float)p.render_in_scatter_samples);
+	__m256 total_density = set8(0.0f);
+	for (int i = 0; i < p.render_in_scatter_samples; ++i) {
+		total_density = total_density + mie_density8(s, position) * step_size;
+		position = mad8(position, light, step_size);
+	}
+	return total_density;
+}
+
+static void cloud_march8(const scene& s, const vec8& direction, __m256& color, __m256& transmittance) {
+	const parameters& p = *s.p;
+	vec8 camera = { set8(s.camera_location.x), set8(s.camera_location.y), set8(s.camera_location.z) };
+	vec8 inverted_direction = { set8(1.0f) / direction.x, set8(1.0f) / direction.y, set8(1.0f) / direction.z };
+	__m256 march_to, march_across;
+	ray_to_cloud8(camera, inverted_direction, s.lower_bound, s.upper_bound, march_to, march_across);
+	__m256 distance_per_step = march_across / set8((float)p.render_volume_samples);
+	vec8 light = { set8(s.light_direction.x), set8(s.light_direction.y), set8(s.light_direction.z) };
+	// henyey greenstein, pow(x, 1.5) -> x * sqrt(x)
+	__m256 g = set8(0.2f);
+	__m256 hg_base = set8(1.0f) + g * g - set8(2.0f) * g * dot8(direction, light);
+	__m256 hg_constant = (set8(1.0f) - g * g) / (hg_base * _mm256_sqrt_ps(hg_base));
+
+	__m256 radiance = set8(1.0f);
+	__m256 color_cloud = set8(0.0f);
+	__m256 distance_travelled = set8(0.0f);
+	__m256 active = _mm256_cmp_ps(distance_travelled, march_across, _CMP_LT_OQ);
+	while (_mm256_movemask_ps(active)) {
+		vec8 ray_position = mad8(camera, direction, march_to + distance_travelled);
+		__m256 density = mie_density8(s, ray_position);
+		radiance = select8(active, radiance * exp8(-density * distance_per_step), radiance);
+		// rays that got dark stop here
+		active = _mm256_and_ps(active, _mm256_cmp_ps(radiance, set8(0.01f), _CMP_GE_OQ));
+		// light is only marched where there's
+		// some density to light
+		__m256 lit = _mm256_and_ps(active, _mm256_cmp_ps(density, set8(0.0f), _CMP_GT_OQ));
+		if (_mm256_movemask_ps(lit)) {
+			__m256 total_density = mie_light_depth8(s, ray_position);
+			__m256 in_light = set8(1.0f - p.render_shadowing_weight) + exp8(-total_density * set8(p.cloud_absorption)) * set8(p.render_shadowing_weight);
+			color_cloud = color_cloud + _mm256_and_ps(lit, density * distance_per_step * in_light * radiance * hg_constant);
+		}
+		distance_travelled = select8(active, distance_travelled + distance_per_step, distance_travelled);
+		active = _mm256_and_ps(active, _mm256_cmp_ps(distance_travelled, march_across, _CMP_LT_OQ));
+	}
+	color = color_cloud;
+	transmittance = radiance;
+}
+
+static inline void atmosphere_density8(const vec8& point, __m256& rayleigh, __m256& mie) {
+	vec8 v = { point.x - set8(earth_center.x), point.y - set8(earth_center.y), point.z - set8(earth_center.z) };
+	__m256 h = max8(set8(0.0f), _mm256_sqrt_ps(dot8(v, v)) - set8(radius_surface));
+	rayleigh = exp8(-h / set8(8e3f));
+	mie = exp8(-h / set8(12e2f));
+}
+
+static inline __m256 atmosphere_march8(const vec8& origin, const vec8& direction, float radius) {
+	vec8 v = { origin.x - set8(earth_center.x), origin.y - set8(earth_center.y), origin.z - set8(earth_center.z) };
+	__m256 b = dot8(v, direction);
+	__m256 d = b * b - dot8(v, v) + set8(radius * radius);
+	__m256 miss = _mm256_cmp_ps(d, set8(0.0f), _CMP_LT_OQ);
+	d = _mm256_sqrt_ps(max8(d, set8(0.0f)));
+	__m256 r1 = -b - d, r2 = -b + d;
+	__m256 l = select8(_mm256_cmp_ps(r1, set8(0.0f), _CMP_GE_OQ), r1, r2);
+	return select8(miss, set8(-1.0f), l);
+}
+
+static inline void atmosphere_light_depth8(const vec8& point, const vec8& light_direction, __m256& rayleigh, __m256& mie) {
+	__m256 l_sde = atmosphere_march8(point, light_direction, radius_atmosphere) / set8((float)SCATTER_DEPTH_STEP);
+	rayleigh = set8(0.0f);
+	mie = set8(0.0f);
+	for (int j = 0; j < SCATTER_DEPTH_STEP; ++j) {
+		__m256 r, m;
+		atmosphere_density8(mad8(point, light_direction, l_sde * set8((float)j)), r, m);
+		rayleigh = rayleigh + r;
+		mie = mie + m;
+	}
+	rayleigh = rayleigh * l_sde;
+	mie = mie * l_sde;
+}
+
+static void sky_color8(const scene& s, const vec8& direction, vec8& color) {
+	const parameters& p = *s.p;
+	if (!p.render_sky) {
+		color = { set8(p.background_color[0]), set8(p.background_color[1]), set8(p.background_color[2]) };
+		return;
+	}
+	vec8 origin = { set8(s.camera_location.x), set8(s.camera_location.y), set8(s.camera_location.z) };
+	vec8 light = { set8(s.light_direction.x), set8(s.light_direction.y), set8(s.light_direction.z) };
+	__m256 l_sin = atmosphere_march8(origin, direction, radius_atmosphere) / set8((float)SCATTER_IN_STEP);
+	__m256 total_rayleigh = set8(0.0f), total_mie = set8(0.0f);
+	vec8 intensity_rayleigh = { set8(0.0f), set8(0.0f), set8(0.0f) };
+	vec8 intensity_mie = intensity_rayleigh;
+	for (int i = 0; i < SCATTER_IN_STEP; ++i) {
+		vec8 point = mad8(origin, direction, l_sin * set8((float)i));
+		__m256 depth_rayleigh, depth_mie;
+		atmosphere_density8(point, depth_rayleigh, depth_mie);
+		depth_rayleigh = depth_rayleigh * l_sin;
+		depth_mie = depth_mie * l_sin;
+		total_rayleigh = total_rayleigh + depth_rayleigh;
+		total_mie = total_mie + depth_mie;
+		__m256 light_rayleigh, light_mie;
+		atmosphere_light_depth8(point, light, light_rayleigh, light_mie);
+		__m256 sum_rayleigh = total_rayleigh + light_rayleigh;
+		__m256 mie_extinction = set8(mie_coefficient_upper) * (total_mie + light_mie);
+		__m256 ax = exp8(-set8(rayleigh_coefficient.x) * sum_rayleigh - mie_extinction);
+		__m256 ay = exp8(-set8(rayleigh_coefficient.y) * sum_rayleigh - mie_extinction);
+		__m256 az = exp8(-set8(rayleigh_coefficient.z) * sum_rayleigh - mie_extinction);
+		intensity_rayleigh = { intensity_rayleigh.x + ax * depth_rayleigh, intensity_rayleigh.y + ay * depth_rayleigh, intensity_rayleigh.z + az * depth_rayleigh };
+		intensity_mie = { intensity_mie.x + ax * depth_mie, intensity_mie.y + ay * depth_mie, intensity_mie.z + az * depth_mie };
+	}
+	__m256 mu = dot8(direction, light);
+	__m256 mie_base = set8(1.58f) - set8(1.52f) * mu;
+	__m256 mie_phase = set8(mie_coefficient_lower * 0.0196f) / (mie_base * _mm256_sqrt_ps(mie_base));
+	__m256 scale = set8(sun_intensity) * (set8(1.0f) + mu * mu);
+	color.x = _mm256_sqrt_ps(scale * (intensity_rayleigh.x * set8(rayleigh_coefficient.x * 0.0597f) + intensity_mie.x * mie_phase));
+	color.y = _mm256_sqrt_ps(scale * (intensity_rayleigh.y * set8(rayleigh_coefficient.y * 0.0597f) + intensity_mie.y * mie_phase));
+	color.z = _mm256_sqrt_ps(scale * (intensity_rayleigh.z * set8(rayleigh_coefficient.z * 0.0597f) + intensity_mie.z * mie_phase));
+}
+
+// count pixels of a row starting at x, up to 8
+static void render_packet8(const scene& s, const glm::mat4& view_matrix, int x, int y, int count, int width, int height, bool bgr, unsigned char* row) {
+	alignas(32) float dx[8], dy[8], dz[8];
+	glm::vec2 size(width, height);
+	for (int i = 0; i < 8; ++i) {
+		// lanes past the row repeat its last pixel
+		glm::vec3 d = ray_direction(glm::vec2(x + std::min(i, count - 1), y) + 0.5f, size, view_matrix);
+		dx[i] = d.x;
+		dy[i] = d.y;
+		dz[i] = d.z;
+	}
+	vec8 direction = { _mm256_load_ps(dx), _mm256_load_ps(dy), _mm256_load_ps(dz) };
+	__m256 cloud, transmittance;
+	cloud_march8(s, direction, cloud, transmittance);
+	vec8 sky;
+	sky_color8(s, direction, sky);
+	alignas(32) float r[8], g[8], b[8];
+	_mm256_store_ps(r, sky.x * transmittance + cloud);
+	_mm256_store_ps(g, sky.y * transmittance + cloud);
+	_mm256_store_ps(b, sky.z * transmittance + cloud);
+	for (int i = 0; i < count; ++i) {
+		store_pixel(row + (x + i) * 3, glm::vec3(r[i], g[i], b[i]), bgr);
+	}
+}
+
+#pragma GCC pop_options
+#endif
+
+// ------------------------------ //
+// -------- the renderer -------- //
+// ------------------------------ //
+
+cpu_renderer::cpu_renderer(int threads, bool bgr, int tile) : time(0.0f), avx2(false), bgr(bgr), tile(tile), busy(0), generation(0), stop(false) {
+#ifdef CPU_RENDERER_AVX2
+	avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+	if (threads <= 0) {
+		threads = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	// the calling thread renders too
+	for (int i = 1; i < threads; ++i) {
+		workers.emplace_back(&cpu_renderer::work, this);
+	}
+}
+
+cpu_renderer::~cpu_renderer() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stop = true;
+	}
+	frame_ready.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+int cpu_renderer::threads() {
+	return workers.size() + 1;
+}
+
+void cpu_renderer::render(const parameters& p, glm::vec3 camera_location, const glm::mat4& view_matrix, float animation_time, int width, int height, unsigned char* pixels) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	current = { &p, camera_location, view_matrix, animation_time, width, height, pixels };
+	columns = (width + tile - 1) / tile;
+	tiles = columns * ((height + tile - 1) / tile);
+	next_tile = 0;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		busy = workers.size();
+		++generation;
+	}
+	frame_ready.notify_all();
+	render_tiles();
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		frame_done.wait(guard, [this] { return busy == 0; });
+	}
+	std::chrono::duration<float, std::milli> elapsed(std::chrono::steady_clock::now() - start);
+	time = elapsed.count();
+}
+
+void cpu_renderer::work() {
+	unsigned long long rendered = 0;
+	std::unique_lock<std::mutex> guard(lock);
+	for (;;) {
+		frame_ready.wait(guard, [&] { return stop || generation != rendered; });
+		if (stop) {
+			return;
+		}
+		rendered = generation;
+		guard.unlock();
+		render_tiles();
+		guard.lock();
+		if (--busy == 0) {
+			frame_done.notify_all();
+		}
+	}
+}
+
+void cpu_renderer::render_tiles() {
+	for (int i = next_tile++; i < tiles; i = next_tile++) {
+		int x = i % columns * tile;
+		int y = i / columns * tile;
+		render_tile(x, y, std::min(tile, current.width - x), std::min(tile, current.height - y));
+	}
+}
+
+void cpu_renderer::render_tile(int x, int y, int width, int height) {
+	const parameters& p = *current.p;
+	scene s;
+	s.p = &p;
+	s.main = &noise_main;
+	s.weather = &noise_weather;
+	s.detail = &noise_detail;
+	s.time = current.animation_time;
+	s.camera_location = current.camera_location;
+	glm::vec3 location(p.cloud_location[0], p.cloud_location[1], p.cloud_location[2]);
+	glm::vec3 volume(p.cloud_volume[0], p.cloud_volume[1], p.cloud_volume[2]);
+	s.lower_bound = location - volume;
+	s.upper_bound = location + volume;
+	s.light_direction = glm::vec3(p.light_direction[0], p.light_direction[1], p.light_direction[2]);
+	s.inverse_light_direction = glm::vec3(p.inverse_light_direction[0], p.inverse_light_direction[1], p.inverse_light_direction[2]);
+
+	glm::vec2 size(current.width, current.height);
+	for (int row = y; row < y + height; ++row) {
+		unsigned char* pixels = current.pixels + (size_t)row * current.width * 3;
+#ifdef CPU_RENDERER_AVX2
+		if (avx2) {
+			for (int column = x; column < x + width; column += 8) {
+				render_packet8(s, current.view_matrix, column, row, std::min(8, x + width - column), current.width, current.height, bgr, pixels);
+			}
+			continue;
+		}
+#endif
+		for (int column = x; column < x + width; ++column) {
+			glm::vec3 direction = ray_direction(glm::vec2(column, row) + 0.5f, size, current.view_matrix);
+			glm::vec4 cloud = cloud_march(s, direction);
+			store_pixel(pixels + column * 3, sky_color(s, direction) * cloud.a + glm::vec3(cloud), bgr);
+		}
+	}
+}
@@ -0,0 +1,82 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <glm/glm.hpp>
+#include "parameters.h"
+
+// the cloud and sky model of data/render.glsl
+// on the cpu, for machines without a gpu and
+// as a reference to check shader changes
+// against. it renders what the shader does
+// with every shortcut off:
+// -> fixed steps, light marched toward the sun
+// -> noise read from the base level, weather
+//    from the whole texture
+// -> sky scattered per pixel, no lookup table
+// the frame is split in tiles handed to a pool
+// of threads. rays are marched in packets of
+// 8 with avx2 when the cpu has it, one at a
+// time otherwise.
+class cpu_renderer {
+	public:
+		// r8 noise texels as floats in [0, 1],
+		// x fastest. weather is a single slice.
+		struct noise_texture {
+			int resolution = 0;
+			std::vector<float> texels;
+		};
+		noise_texture noise_main;
+		noise_texture noise_weather;
+		noise_texture noise_detail;
+		// ms, last render
+		float time;
+		bool avx2;
+
+		// 0 threads -> one per core. bgr for
+		// opencv, rgb otherwise
+		cpu_renderer(int threads = 0, bool bgr = true, int tile = 32);
+		~cpu_renderer();
+
+		// tightly packed rows from the bottom up,
+		// like a read of the framebuffer
+		void render(const parameters& p, glm::vec3 camera_location, const glm::mat4& view_matrix, float animation_time, int width, int height, unsigned char* pixels);
+		int threads();
+
+	private:
+		struct frame {
+			const parameters* p;
+			glm::vec3 camera_location;
+			glm::mat4 view_matrix;
+			float animation_time;
+			int width;
+			int height;
+			unsigned char* pixels;
+		};
+		frame current;
+		bool bgr;
+		int tile;
+		int columns;
+		int tiles;
+		std::atomic<int> next_tile;
+		int busy;
+		unsigned long long generation;
+		bool stop;
+		std::mutex lock;
+		std::condition_variable frame_ready;
+		std::condition_variable frame_done;
+		std::vector<std::thread> workers;
+
+		void work();
+		// renders tiles until there are none left
+		void render_tiles();
+		void render_tile(int x, int y, int width, int height);
+};
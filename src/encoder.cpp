@@ -0,0 +1,84 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#include <chrono>
+#include "encoder.h"
+
+frame_encoder::frame_encoder(int width, int height, int frames, int workers) : width(width), height(height), stalls(0), stall(0.0f), busy(0), stop(false) {
+	// allocated once, here. the pointers handed
+	// out stay valid since the vector never
+	// grows.
+	this->frames.reserve(frames);
+	for (int i = 0; i < frames; ++i) {
+		this->frames.emplace_back(height, width, CV_8UC3);
+		free_frames.push_back(&this->frames.back());
+	}
+	for (int i = 0; i < workers; ++i) {
+		threads.emplace_back(&frame_encoder::work, this);
+	}
+}
+
+frame_encoder::~frame_encoder() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stop = true;
+	}
+	job_ready.notify_all();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+cv::Mat* frame_encoder::acquire() {
+	std::unique_lock<std::mutex> guard(lock);
+	if (free_frames.empty()) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		frame_free.wait(guard, [this] { return !free_frames.empty(); });
+		std::chrono::duration<float, std::milli> waited(std::chrono::steady_clock::now() - start);
+		stall = waited.count();
+		++stalls;
+	}
+	cv::Mat* frame = free_frames.back();
+	free_frames.pop_back();
+	return frame;
+}
+
+void frame_encoder::submit(cv::Mat* frame, std::function<void(cv::Mat&)> write) {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		jobs.push_back({ frame, write });
+	}
+	job_ready.notify_one();
+}
+
+void frame_encoder::finish() {
+	std::unique_lock<std::mutex> guard(lock);
+	frame_free.wait(guard, [this] { return jobs.empty() && busy == 0; });
+}
+
+int frame_encoder::queued() {
+	std::lock_guard<std::mutex> guard(lock);
+	return jobs.size() + busy;
+}
+
+void frame_encoder::work() {
+	std::unique_lock<std::mutex> guard(lock);
+	for (;;) {
+		// queued jobs are written before stopping
+		job_ready.wait(guard, [this] { return stop || !jobs.empty(); });
+		if (jobs.empty()) {
+			return;
+		}
+		job current = jobs.front();
+		jobs.pop_front();
+		++busy;
+		guard.unlock();
+		current.write(*current.frame);
+		guard.lock();
+		--busy;
+		free_frames.push_back(current.frame);
+		frame_free.notify_all();
+	}
+}
@@ -0,0 +1,64 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <opencv2/core.hpp>
+
+// frames handed from the render loop to
+// worker threads that write them out. the
+// buffers come from a fixed pool, so there's
+// no allocation per frame. when the workers
+// fall behind the pool runs dry and acquire()
+// waits -> back-pressure, counted in stalls.
+// with one worker frames are written in the
+// order they're submitted.
+class frame_encoder {
+	public:
+		int width;
+		int height;
+		// acquires that had to wait for a buffer
+		// and how long the last of them waited
+		unsigned long long stalls;
+		float stall;
+
+		frame_encoder(int width, int height, int frames = 6, int workers = 1);
+		// writes whatever is still queued
+		~frame_encoder();
+
+		// free bgr buffer, top row first
+		cv::Mat* acquire();
+		// write runs on a worker. the frame goes
+		// back to the pool afterwards.
+		void submit(cv::Mat* frame, std::function<void(cv::Mat&)> write);
+		// waits until everything submitted is
+		// written
+		void finish();
+		// frames submitted but not written yet
+		int queued();
+
+	private:
+		struct job {
+			cv::Mat* frame;
+			std::function<void(cv::Mat&)> write;
+		};
+		std::vector<cv::Mat> frames;
+		std::vector<cv::Mat*> free_frames;
+		std::deque<job> jobs;
+		int busy;
+		bool stop;
+		std::mutex lock;
+		std::condition_variable job_ready;
+		std::condition_variable frame_free;
+		std::vector<std::thread> threads;
+
+		void work();
+};
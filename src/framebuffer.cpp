@@ -0,0 +1,61 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#include <iostream>
+#include <GL/glew.h>
+#include "framebuffer.h"
+
+unsigned int framebuffer::screen_id = 0;
+
+framebuffer::framebuffer(int width, int height, int attachments) : width(width), height(height) {
+	glGenFramebuffers(1, &framebuffer_id);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_id);
+
+	texture_ids.resize(attachments);
+	glGenTextures(attachments, &texture_ids[0]);
+	std::vector<unsigned int> draw_buffers(attachments);
+	for (int i = 0; i < attachments; ++i) {
+		// same convention as the noise textures:
+		// texture unit index == texture id
+		glActiveTexture(GL_TEXTURE0 + texture_ids[i]);
+		glBindTexture(GL_TEXTURE_2D, texture_ids[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, texture_ids[i], 0);
+		draw_buffers[i] = GL_COLOR_ATTACHMENT0 + i;
+	}
+	glDrawBuffers(attachments, &draw_buffers[0]);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "[-] Framebuffer " << width << "x" << height << " is incomplete" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, screen_id);
+}
+
+framebuffer::~framebuffer() {
+	glDeleteTextures(texture_ids.size(), &texture_ids[0]);
+	glDeleteFramebuffers(1, &framebuffer_id);
+}
+
+void framebuffer::bind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_id);
+	glViewport(0, 0, width, height);
+}
+
+void framebuffer::unbind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, screen_id);
+}
+
+void framebuffer::blit(int attachment, int screen_width, int screen_height) {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_id);
+	glReadBuffer(GL_COLOR_ATTACHMENT0 + attachment);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, screen_id);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, screen_width, screen_height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, screen_id);
+	glViewport(0, 0, screen_width, screen_height);
+}
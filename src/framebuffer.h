@@ -0,0 +1,31 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#pragma once
+
+#include <vector>
+
+// offscreen render target with one or more
+// floating point color attachments.
+class framebuffer {
+	public:
+		unsigned int framebuffer_id;
+		std::vector<unsigned int> texture_ids;
+		int width;
+		int height;
+
+		// the framebuffer unbind() and blit() go
+		// back to. 0 -> the window's. headless
+		// runs point it at a framebuffer object.
+		static unsigned int screen_id;
+
+		framebuffer(int width, int height, int attachments = 1);
+		~framebuffer();
+
+		void bind();
+		void unbind();
+		// copy an attachment to the default framebuffer
+		void blit(int attachment, int screen_width, int screen_height);
+};
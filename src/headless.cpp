@@ -0,0 +1,77 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#include <iostream>
+#include <cstring>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "headless.h"
+
+static EGLDisplay display = EGL_NO_DISPLAY;
+static EGLContext context = EGL_NO_CONTEXT;
+
+static bool has_extension(const char* extensions, const char* name) {
+	return extensions && std::strstr(extensions, name);
+}
+
+bool headless_init() {
+	// the surfaceless platform doesn't look for
+	// x or wayland at all. older drivers only
+	// have the default display.
+	const char* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (get_platform_display && has_extension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+		display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if (display == EGL_NO_DISPLAY) {
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+		std::cout << "[-] Couldn't initialize an EGL display" << std::endl;
+		return false;
+	}
+	if (!has_extension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+		std::cout << "[-] EGL " << major << "." << minor << " can't make a context current without a surface" << std::endl;
+		headless_terminate();
+		return false;
+	}
+	eglBindAPI(EGL_OPENGL_API);
+
+	// any config that renders opengl will do:
+	// nothing is drawn to an egl surface
+	const EGLint config_attributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config;
+	EGLint configs = 0;
+	if (!eglChooseConfig(display, config_attributes, &config, 1, &configs) || configs == 0) {
+		config = (EGLConfig)0; // EGL_NO_CONFIG_KHR
+	}
+	const EGLint context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 4,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		std::cout << "[-] Couldn't create an OpenGL 4.4 core context through EGL" << std::endl;
+		headless_terminate();
+		return false;
+	}
+	return true;
+}
+
+void headless_terminate() {
+	if (display == EGL_NO_DISPLAY) {
+		return;
+	}
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (context != EGL_NO_CONTEXT) {
+		eglDestroyContext(display, context);
+		context = EGL_NO_CONTEXT;
+	}
+	eglTerminate(display);
+	display = EGL_NO_DISPLAY;
+}
@@ -0,0 +1,15 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#pragma once
+
+// opengl 4.4 core context without a window or
+// a display server: surfaceless egl. works on
+// render nodes and on mesa's llvmpipe, where
+// there's no gpu at all. there's no default
+// framebuffer, so everything has to be drawn
+// into a framebuffer object.
+bool headless_init();
+void headless_terminate();
@@ -0,0 +1,117 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include "image_writer.h"
+
+// little endian tiff, one rgb strip
+static std::vector<unsigned char> tiff_header(int width, int height) {
+	struct entry {
+		uint16_t tag;
+		uint16_t type; // 3 -> short, 4 -> long
+		uint32_t value;
+	};
+	const int entries = 10;
+	const uint32_t bits_offset = 8 + 2 + entries * 12 + 4;
+	const uint32_t raster_offset = bits_offset + 6;
+	const entry ifd[entries] = {
+		{ 256, 4, (uint32_t)width },                  // image width
+		{ 257, 4, (uint32_t)height },                 // image length
+		{ 258, 3, bits_offset },                      // bits per sample, 3 of them
+		{ 259, 3, 1 },                                // no compression
+		{ 262, 3, 2 },                                // rgb
+		{ 273, 4, raster_offset },                    // strip offset
+		{ 277, 3, 3 },                                // samples per pixel
+		{ 278, 4, (uint32_t)height },                 // rows per strip
+		{ 279, 4, (uint32_t)width * height * 3 },     // strip byte count
+		{ 284, 3, 1 }                                 // chunky
+	};
+	std::vector<unsigned char> header;
+	auto put = [&](uint32_t value, int bytes) {
+		for (int i = 0; i < bytes; ++i) {
+			header.push_back((value >> (8 * i)) & 0xff);
+		}
+	};
+	put('I' | 'I' << 8, 2);
+	put(42, 2);
+	put(8, 4);
+	put(entries, 2);
+	for (const entry& e : ifd) {
+		put(e.tag, 2);
+		put(e.type, 2);
+		put(e.tag == 258 ? 3 : 1, 4);
+		// a short goes in the field's first two
+		// bytes, same as a little endian long
+		put(e.value, 4);
+	}
+	put(0, 4);
+	put(8, 2);
+	put(8, 2);
+	put(8, 2);
+	return header;
+}
+
+image_writer::image_writer() : width(0), height(0), file(nullptr), raster_offset(0) {}
+
+image_writer::~image_writer() {
+	close();
+}
+
+bool image_writer::open(const std::string& path, int width, int height) {
+	close();
+	this->width = width;
+	this->height = height;
+	std::string extension = path.substr(path.find_last_of('.') + 1);
+	std::vector<unsigned char> header;
+	if (extension == "ppm") {
+		std::string text = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+		header.assign(text.begin(), text.end());
+	} else if (extension == "tif" || extension == "tiff") {
+		if ((long long)width * height * 3 > 0xffffffffll) {
+			std::cout << "[-] " << width << "x" << height << " is too large for a tiff, use a ppm" << std::endl;
+			return false;
+		}
+		header = tiff_header(width, height);
+	} else {
+		std::cout << "[-] Tiled stills are written as .ppm or .tif, not ." << extension << std::endl;
+		return false;
+	}
+	file = std::fopen(path.c_str(), "wb");
+	if (file == nullptr) {
+		std::cout << "[-] Couldn't write " << path << std::endl;
+		return false;
+	}
+	std::fwrite(&header[0], 1, header.size(), file);
+	raster_offset = header.size();
+	return true;
+}
+
+bool image_writer::write(const unsigned char* pixels, int x, int y, int width, int height, int stride) {
+	if (file == nullptr) {
+		return false;
+	}
+	// files go top down
+	for (int row = 0; row < height; ++row) {
+		long long line = this->height - 1 - (y + row);
+		if (fseeko(file, raster_offset + (line * this->width + x) * 3, SEEK_SET) != 0) {
+			return false;
+		}
+		if (std::fwrite(pixels + (long long)row * stride * 3, 3, width, file) != (size_t)width) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool image_writer::close() {
+	if (file == nullptr) {
+		return true;
+	}
+	bool written = std::fclose(file) == 0;
+	file = nullptr;
+	return written;
+}
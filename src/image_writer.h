@@ -0,0 +1,37 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#pragma once
+
+#include <string>
+#include <cstdio>
+
+// uncompressed image file written a block of
+// pixels at a time, straight to its place in
+// the file. nothing but the block is ever in
+// memory, so stills can be larger than ram.
+// binary ppm, or tiff with a single strip
+// (.tif / .tiff) -> up to 4gb of pixels.
+class image_writer {
+	public:
+		int width;
+		int height;
+
+		image_writer();
+		~image_writer();
+
+		bool open(const std::string& path, int width, int height);
+		// rgb rows bottom up, as read from opengl.
+		// x, y is the block's lower left pixel,
+		// counted from the image's lower left.
+		// stride is the block's row length in
+		// pixels.
+		bool write(const unsigned char* pixels, int x, int y, int width, int height, int stride);
+		bool close();
+
+	private:
+		FILE* file;
+		long long raster_offset;
+};
@@ -0,0 +1,30 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#include <cstdio>
+#include "json.h"
+
+std::string json_escape(const std::string& text) {
+	std::string escaped;
+	escaped.reserve(text.size());
+	for (char c : text) {
+		switch (c) {
+			case '"': escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n"; break;
+			case '\r': escaped += "\\r"; break;
+			case '\t': escaped += "\\t"; break;
+			default:
+				if ((unsigned char)c < 0x20) {
+					char code[8];
+					std::snprintf(code, sizeof(code), "\\u%04x", (unsigned char)c);
+					escaped += code;
+				} else {
+					escaped += c;
+				}
+		}
+	}
+	return escaped;
+}
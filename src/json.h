@@ -0,0 +1,14 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#pragma once
+
+#include <string>
+
+// text as the inside of a json string: quotes,
+// backslashes and control characters escaped.
+// for names and driver strings written into
+// traces and bench reports.
+std::string json_escape(const std::string& text);
@@ -0,0 +1,344 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include "noise_baker.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NOISE_BAKER_AVX2
+#include <immintrin.h>
+#endif
+
+// same order as data/worley.glsl's z, y, x
+// loops
+static const int offsets_3d[27][3] = {
+	{ -1, -1, -1 }, { 0, -1, -1 }, { 1, -1, -1 }, { -1, 0, -1 }, { 0, 0, -1 }, { 1, 0, -1 }, { -1, 1, -1 }, { 0, 1, -1 }, { 1, 1, -1 },
+	{ -1, -1, 0 }, { 0, -1, 0 }, { 1, -1, 0 }, { -1, 0, 0 }, { 0, 0, 0 }, { 1, 0, 0 }, { -1, 1, 0 }, { 0, 1, 0 }, { 1, 1, 0 },
+	{ -1, -1, 1 }, { 0, -1, 1 }, { 1, -1, 1 }, { -1, 0, 1 }, { 0, 0, 1 }, { 1, 0, 1 }, { -1, 1, 1 }, { 0, 1, 1 }, { 1, 1, 1 }
+};
+
+// same order as data/compute_weather.glsl
+static const int offsets_2d[9][2] = {
+	{ 0, 0 },
+	{ -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, 1 }, { 0, -1 }, { 1, 1 }, { 1, 0 }, { 1, -1 }
+};
+
+// -------------------------------- //
+// -------- feature points -------- //
+// -------------------------------- //
+
+// data/hash.glsl's pcg hashes
+
+static void pcg3d(uint32_t v[3]) {
+	for (int i = 0; i < 3; ++i) v[i] = v[i] * 1664525u + 1013904223u;
+	v[0] += v[1] * v[2];
+	v[1] += v[2] * v[0];
+	v[2] += v[0] * v[1];
+	for (int i = 0; i < 3; ++i) v[i] ^= v[i] >> 16u;
+	v[0] += v[1] * v[2];
+	v[1] += v[2] * v[0];
+	v[2] += v[0] * v[1];
+}
+
+static void pcg4d(uint32_t v[4]) {
+	for (int i = 0; i < 4; ++i) v[i] = v[i] * 1664525u + 1013904223u;
+	v[0] += v[1] * v[3];
+	v[1] += v[2] * v[0];
+	v[2] += v[0] * v[1];
+	v[3] += v[1] * v[2];
+	for (int i = 0; i < 4; ++i) v[i] ^= v[i] >> 16u;
+	v[0] += v[1] * v[3];
+	v[1] += v[2] * v[0];
+	v[2] += v[0] * v[1];
+	v[3] += v[1] * v[2];
+}
+
+static float unit(uint32_t h) {
+	return (float)h * (1.0f / 4294967296.0f);
+}
+
+// the points of a layer's cells, hashed once
+// up front instead of by every texel, x
+// fastest
+static std::vector<glm::vec4> volume_grid(int sub, int seed, int layer) {
+	std::vector<glm::vec4> points((size_t)sub * sub * sub);
+	for (int k = 0; k < sub; ++k) {
+		for (int j = 0; j < sub; ++j) {
+			for (int i = 0; i < sub; ++i) {
+				uint32_t h[4] = { (uint32_t)i, (uint32_t)j, (uint32_t)k, (uint32_t)seed * 8u + (uint32_t)layer };
+				pcg4d(h);
+				glm::vec3 point = (glm::vec3((float)i, (float)j, (float)k) + glm::vec3(unit(h[0]), unit(h[1]), unit(h[2]))) / (float)sub;
+				points[i + sub * (j + k * sub)] = glm::vec4(point, 0.0f);
+			}
+		}
+	}
+	return points;
+}
+
+static std::vector<glm::vec4> plane_grid(int sub, int seed, int layer) {
+	std::vector<glm::vec4> points((size_t)sub * sub);
+	for (int j = 0; j < sub; ++j) {
+		for (int i = 0; i < sub; ++i) {
+			uint32_t h[3] = { (uint32_t)i, (uint32_t)j, (uint32_t)seed * 8u + (uint32_t)layer };
+			pcg3d(h);
+			glm::vec2 point = (glm::vec2((float)i, (float)j) + glm::vec2(unit(h[0]), unit(h[1]))) / (float)sub;
+			points[i + sub * j] = glm::vec4(point, 0.0f, 0.0f);
+		}
+	}
+	return points;
+}
+
+// ---------------------------- //
+// -------- one by one -------- //
+// ---------------------------- //
+
+// cells past the grid's edge hold the point
+// of the cell they wrap to, moved a texture
+// over -> the noise repeats seamlessly
+static float worley_layer(glm::vec3 pos, int sub, const glm::vec4* points) {
+	int cell[3] = { (int)std::floor(pos.x * sub), (int)std::floor(pos.y * sub), (int)std::floor(pos.z * sub) };
+	float min_dist = 1.0f;
+	for (int o = 0; o < 27; ++o) {
+		int adj[3];
+		float shift[3];
+		for (int i = 0; i < 3; ++i) {
+			adj[i] = cell[i] + offsets_3d[o][i];
+			shift[i] = adj[i] == -1 ? -1.0f : adj[i] == sub ? 1.0f : 0.0f;
+			adj[i] = (adj[i] + sub) % sub;
+		}
+		const glm::vec4& point = points[adj[0] + sub * (adj[1] + adj[2] * sub)];
+		float dx = pos.x - (point.x + shift[0]);
+		float dy = pos.y - (point.y + shift[1]);
+		float dz = pos.z - (point.z + shift[2]);
+		min_dist = std::min(min_dist, dx * dx + dy * dy + dz * dz);
+	}
+	return std::sqrt(min_dist);
+}
+
+static float worley_layer(glm::vec2 pos, int sub, const glm::vec4* points) {
+	int cell[2] = { (int)std::floor(pos.x * sub), (int)std::floor(pos.y * sub) };
+	float min_dist = 1.0f;
+	for (int o = 0; o < 9; ++o) {
+		int adj[2];
+		float shift[2];
+		for (int i = 0; i < 2; ++i) {
+			adj[i] = cell[i] + offsets_2d[o][i];
+			shift[i] = adj[i] == -1 ? -1.0f : adj[i] == sub ? 1.0f : 0.0f;
+			adj[i] = (adj[i] + sub) % sub;
+		}
+		const glm::vec4& point = points[adj[0] + sub * adj[1]];
+		float dx = pos.x - (point.x + shift[0]);
+		float dy = pos.y - (point.y + shift[1]);
+		min_dist = std::min(min_dist, dx * dx + dy * dy);
+	}
+	return std::sqrt(min_dist);
+}
+
+// data/worley.glsl's combine_worley_layers,
+// stored as an r8 image would
+static unsigned char combine_worley_layers(float layer_a, float layer_b, float layer_c, float persistance) {
+	float noise_sum = layer_a + (layer_b * persistance) + (layer_c * persistance * persistance);
+	noise_sum /= (1.0f + persistance + (persistance * persistance));
+	noise_sum = 1.0f - noise_sum;
+	noise_sum = noise_sum * noise_sum * noise_sum * noise_sum;
+	return (unsigned char)(std::min(std::max(noise_sum, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// ----------------------------- //
+// -------- 8 at a time -------- //
+// ----------------------------- //
+
+// 8 neighbouring texels of a row. each lane
+// gathers the point of its own cell, so
+// lanes may straddle cells.
+
+#ifdef NOISE_BAKER_AVX2
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+// wraps adj into the grid, shift gets the
+// texture the lanes' cells moved by
+static inline __m256i wrap_cell8(__m256i adj, int sub, __m256& shift) {
+	__m256i low = _mm256_cmpeq_epi32(adj, _mm256_set1_epi32(-1));
+	__m256i high = _mm256_cmpeq_epi32(adj, _mm256_set1_epi32(sub));
+	shift = _mm256_and_ps(_mm256_castsi256_ps(high), _mm256_set1_ps(1.0f));
+	shift = _mm256_or_ps(shift, _mm256_and_ps(_mm256_castsi256_ps(low), _mm256_set1_ps(-1.0f)));
+	__m256i size = _mm256_set1_epi32(sub);
+	return _mm256_sub_epi32(_mm256_add_epi32(adj, _mm256_and_si256(low, size)), _mm256_and_si256(high, size));
+}
+
+static __m256 worley_layer8(__m256 px, __m256 py, __m256 pz, int sub, const glm::vec4* points) {
+	__m256 size = _mm256_set1_ps((float)sub);
+	__m256i cx = _mm256_cvttps_epi32(_mm256_floor_ps(px * size));
+	__m256i cy = _mm256_cvttps_epi32(_mm256_floor_ps(py * size));
+	__m256i cz = _mm256_cvttps_epi32(_mm256_floor_ps(pz * size));
+	const float* base = (const float*)points;
+	__m256 min_dist = _mm256_set1_ps(1.0f);
+	for (int o = 0; o < 27; ++o) {
+		__m256 sx, sy, sz;
+		__m256i ax = wrap_cell8(_mm256_add_epi32(cx, _mm256_set1_epi32(offsets_3d[o][0])), sub, sx);
+		__m256i ay = wrap_cell8(_mm256_add_epi32(cy, _mm256_set1_epi32(offsets_3d[o][1])), sub, sy);
+		__m256i az = wrap_cell8(_mm256_add_epi32(cz, _mm256_set1_epi32(offsets_3d[o][2])), sub, sz);
+		// 4 floats per point
+		__m256i index = _mm256_slli_epi32(_mm256_add_epi32(ax, _mm256_mullo_epi32(_mm256_set1_epi32(sub), _mm256_add_epi32(ay, _mm256_mullo_epi32(az, _mm256_set1_epi32(sub))))), 2);
+		__m256 dx = px - (_mm256_i32gather_ps(base, index, 4) + sx);
+		__m256 dy = py - (_mm256_i32gather_ps(base + 1, index, 4) + sy);
+		__m256 dz = pz - (_mm256_i32gather_ps(base + 2, index, 4) + sz);
+		min_dist = _mm256_min_ps(min_dist, dx * dx + dy * dy + dz * dz);
+	}
+	return _mm256_sqrt_ps(min_dist);
+}
+
+static __m256 worley_layer8(__m256 px, __m256 py, int sub, const glm::vec4* points) {
+	__m256 size = _mm256_set1_ps((float)sub);
+	__m256i cx = _mm256_cvttps_epi32(_mm256_floor_ps(px * size));
+	__m256i cy = _mm256_cvttps_epi32(_mm256_floor_ps(py * size));
+	const float* base = (const float*)points;
+	__m256 min_dist = _mm256_set1_ps(1.0f);
+	for (int o = 0; o < 9; ++o) {
+		__m256 sx, sy;
+		__m256i ax = wrap_cell8(_mm256_add_epi32(cx, _mm256_set1_epi32(offsets_2d[o][0])), sub, sx);
+		__m256i ay = wrap_cell8(_mm256_add_epi32(cy, _mm256_set1_epi32(offsets_2d[o][1])), sub, sy);
+		__m256i index = _mm256_slli_epi32(_mm256_add_epi32(ax, _mm256_mullo_epi32(_mm256_set1_epi32(sub), ay)), 2);
+		__m256 dx = px - (_mm256_i32gather_ps(base, index, 4) + sx);
+		__m256 dy = py - (_mm256_i32gather_ps(base + 1, index, 4) + sy);
+		min_dist = _mm256_min_ps(min_dist, dx * dx + dy * dy);
+	}
+	return _mm256_sqrt_ps(min_dist);
+}
+
+// x position of 8 texels from x on
+static inline __m256 row8(int x, int resolution) {
+	__m256 texel = _mm256_add_ps(_mm256_set1_ps((float)x), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+	return texel / _mm256_set1_ps((float)resolution);
+}
+
+static void store8(unsigned char* texels, __m256 a, __m256 b, __m256 c, float persistance) {
+	alignas(32) float layers[3][8];
+	_mm256_store_ps(layers[0], a);
+	_mm256_store_ps(layers[1], b);
+	_mm256_store_ps(layers[2], c);
+	for (int i = 0; i < 8; ++i) {
+		texels[i] = combine_worley_layers(layers[0][i], layers[1][i], layers[2][i], persistance);
+	}
+}
+
+static void bake_volume_row8(unsigned char* texels, int x, int y, int z, int resolution, float persistance, const glm::vec4* const points[3], const int subdivisions[3]) {
+	__m256 px = row8(x, resolution);
+	__m256 py = _mm256_set1_ps((float)y / (float)resolution);
+	__m256 pz = _mm256_set1_ps((float)z / (float)resolution);
+	__m256 a = worley_layer8(px, py, pz, subdivisions[0], points[0]);
+	__m256 b = worley_layer8(px, py, pz, subdivisions[1], points[1]);
+	__m256 c = worley_layer8(px, py, pz, subdivisions[2], points[2]);
+	store8(texels, a, b, c, persistance);
+}
+
+static void bake_plane_row8(unsigned char* texels, int x, int y, int resolution, float persistance, const glm::vec4* const points[3], const int subdivisions[3]) {
+	__m256 px = row8(x, resolution);
+	__m256 py = _mm256_set1_ps((float)y / (float)resolution);
+	__m256 a = worley_layer8(px, py, subdivisions[0], points[0]);
+	__m256 b = worley_layer8(px, py, subdivisions[1], points[1]);
+	__m256 c = worley_layer8(px, py, subdivisions[2], points[2]);
+	store8(texels, a, b, c, persistance);
+}
+
+#pragma GCC pop_options
+#endif
+
+// --------------------------- //
+// -------- the baker -------- //
+// --------------------------- //
+
+noise_baker::noise_baker(int threads) : threads(threads), time(0.0f), avx2(false) {
+#ifdef NOISE_BAKER_AVX2
+	avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+	if (this->threads <= 0) {
+		this->threads = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+}
+
+// runs slab(first, last) for every thread's
+// share of count slices
+template <class function>
+static float run_slabs(int threads, int count, function slab) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	threads = std::min(threads, count);
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threads; ++i) {
+		workers.emplace_back(slab, count * i / threads, count * (i + 1) / threads);
+	}
+	slab(0, count / threads);
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	std::chrono::duration<float, std::milli> elapsed(std::chrono::steady_clock::now() - start);
+	return elapsed.count();
+}
+
+void noise_baker::bake_volume(unsigned char* texels, int resolution, float persistance, int seed, const int subdivisions[3]) {
+	std::vector<glm::vec4> grids[3];
+	for (int layer = 0; layer < 3; ++layer) {
+		grids[layer] = volume_grid(subdivisions[layer], seed, layer);
+	}
+	const glm::vec4* const points[3] = { grids[0].data(), grids[1].data(), grids[2].data() };
+	bool wide = avx2;
+	time = run_slabs(threads, resolution, [=](int first, int last) {
+		for (int z = first; z < last; ++z) {
+			for (int y = 0; y < resolution; ++y) {
+				unsigned char* row = texels + ((size_t)z * resolution + y) * resolution;
+				int x = 0;
+#ifdef NOISE_BAKER_AVX2
+				if (wide) {
+					for (; x + 8 <= resolution; x += 8) {
+						bake_volume_row8(row + x, x, y, z, resolution, persistance, points, subdivisions);
+					}
+				}
+#endif
+				for (; x < resolution; ++x) {
+					glm::vec3 position((float)x / resolution, (float)y / resolution, (float)z / resolution);
+					float layer_a = worley_layer(position, subdivisions[0], points[0]);
+					float layer_b = worley_layer(position, subdivisions[1], points[1]);
+					float layer_c = worley_layer(position, subdivisions[2], points[2]);
+					row[x] = combine_worley_layers(layer_a, layer_b, layer_c, persistance);
+				}
+			}
+		}
+	});
+}
+
+void noise_baker::bake_plane(unsigned char* texels, int resolution, float persistance, int seed, const int subdivisions[3]) {
+	std::vector<glm::vec4> grids[3];
+	for (int layer = 0; layer < 3; ++layer) {
+		grids[layer] = plane_grid(subdivisions[layer], seed, layer);
+	}
+	const glm::vec4* const points[3] = { grids[0].data(), grids[1].data(), grids[2].data() };
+	bool wide = avx2;
+	time = run_slabs(threads, resolution, [=](int first, int last) {
+		for (int y = first; y < last; ++y) {
+			unsigned char* row = texels + (size_t)y * resolution;
+			int x = 0;
+#ifdef NOISE_BAKER_AVX2
+			if (wide) {
+				for (; x + 8 <= resolution; x += 8) {
+					bake_plane_row8(row + x, x, y, resolution, persistance, points, subdivisions);
+				}
+			}
+#endif
+			for (; x < resolution; ++x) {
+				glm::vec2 position((float)x / resolution, (float)y / resolution);
+				float layer_a = worley_layer(position, subdivisions[0], points[0]);
+				float layer_b = worley_layer(position, subdivisions[1], points[1]);
+				float layer_c = worley_layer(position, subdivisions[2], points[2]);
+				row[x] = combine_worley_layers(layer_a, layer_b, layer_c, persistance);
+			}
+		}
+	});
+}
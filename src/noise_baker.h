@@ -0,0 +1,36 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// worley fbm of data/compute_main.glsl and
+// data/compute_weather.glsl on the cpu. it
+// needs no gl context, and hashes the same
+// feature points from the seed, so it bakes
+// the same textures.
+// every thread owns a slab of z slices (rows
+// of the weather map). texels are computed 8
+// along x at a time with avx2 when the cpu
+// has it, one at a time otherwise.
+class noise_baker {
+	public:
+		int threads;
+		// ms, last bake
+		float time;
+		bool avx2;
+
+		// 0 threads -> one per core
+		noise_baker(int threads = 0);
+
+		// resolution^3 r8 texels, x fastest.
+		// layer i is a grid of subdivisions[i]^3
+		// cells, points hashed from seed.
+		void bake_volume(unsigned char* texels, int resolution, float persistance, int seed, const int subdivisions[3]);
+		// resolution^2 r8 texels of the repeating
+		// weather map. subdivisions^2 cells.
+		void bake_plane(unsigned char* texels, int resolution, float persistance, int seed, const int subdivisions[3]);
+};
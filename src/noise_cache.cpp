@@ -0,0 +1,147 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <GL/glew.h>
+#include "noise_cache.h"
+
+// bump when compute_main.glsl,
+// compute_weather.glsl, noise_baker or the
+// point hashes change what a bake gives
+static const unsigned int generator_version = 3;
+
+// 64 bytes, so the texels that follow are as
+// aligned as the mapping is
+struct header {
+	char magic[4];
+	unsigned int version;
+	unsigned int dimensions;
+	unsigned int resolution;
+	float persistance;
+	int subdivisions[3];
+	int seed;
+	unsigned int reserved[7];
+};
+static_assert(sizeof(header) == 64, "noise cache header");
+
+static header make_header(bool volume, int resolution, float persistance, const int subdivisions[3], int seed) {
+	header h;
+	std::memset(&h, 0, sizeof(h));
+	std::memcpy(h.magic, "aonz", 4);
+	h.version = generator_version;
+	h.dimensions = volume ? 3 : 2;
+	h.resolution = resolution;
+	h.persistance = persistance;
+	for (int i = 0; i < 3; ++i) {
+		h.subdivisions[i] = subdivisions[i];
+	}
+	h.seed = seed;
+	return h;
+}
+
+// fnv-1a of the whole header, the key
+static std::string file_name(const header& h) {
+	unsigned long long hash = 14695981039346656037ull;
+	const unsigned char* bytes = (const unsigned char*)&h;
+	for (size_t i = 0; i < sizeof(h); ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	char name[32];
+	std::snprintf(name, sizeof(name), "noise_%016llx.raw", hash);
+	return name;
+}
+
+static size_t texel_count(const header& h) {
+	size_t count = (size_t)h.resolution * h.resolution;
+	return h.dimensions == 3 ? count * h.resolution : count;
+}
+
+noise_cache::noise_cache(const std::string& folder) :
+	time(0.0f),
+	hits(0),
+	misses(0),
+	folder(folder) {
+}
+
+bool noise_cache::load(bool volume, int resolution, float persistance, const int subdivisions[3], int seed) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	header key = make_header(volume, resolution, persistance, subdivisions, seed);
+	std::string path = folder + file_name(key);
+	size_t size = sizeof(header) + texel_count(key);
+
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		++misses;
+		return false;
+	}
+	struct stat status;
+	void* mapping = MAP_FAILED;
+	if (fstat(file, &status) == 0 && (size_t)status.st_size == size) {
+		mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+	}
+	// the mapping outlives the descriptor
+	close(file);
+	// a different size, or a hash collision
+	if (mapping == MAP_FAILED || std::memcmp(mapping, &key, sizeof(header)) != 0) {
+		if (mapping != MAP_FAILED) {
+			munmap(mapping, size);
+		}
+		++misses;
+		return false;
+	}
+	// advice values aren't flags, one a call
+	madvise(mapping, size, MADV_SEQUENTIAL);
+	madvise(mapping, size, MADV_WILLNEED);
+
+	// the driver reads the pages as it copies
+	// them, nothing is staged on our side
+	const unsigned char* texels = (const unsigned char*)mapping + sizeof(header);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (volume) {
+		glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, resolution, resolution, resolution, GL_RED, GL_UNSIGNED_BYTE, texels);
+	} else {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, resolution, resolution, GL_RED, GL_UNSIGNED_BYTE, texels);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	munmap(mapping, size);
+
+	++hits;
+	std::chrono::duration<float, std::milli> elapsed(std::chrono::steady_clock::now() - start);
+	time = elapsed.count();
+	return true;
+}
+
+void noise_cache::store(bool volume, int resolution, float persistance, const int subdivisions[3], int seed, const unsigned char* texels) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	header key = make_header(volume, resolution, persistance, subdivisions, seed);
+	mkdir(folder.c_str(), 0755);
+	// written aside and renamed into place, like
+	// the program binaries
+	std::string path = folder + file_name(key);
+	std::string temporary = path + ".tmp" + std::to_string(getpid());
+	{
+		std::ofstream file(temporary, std::ios::binary);
+		file.write((const char*)&key, sizeof(header));
+		file.write((const char*)texels, texel_count(key));
+		if (!file) {
+			file.close();
+			std::remove(temporary.c_str());
+			std::cout << "[-] Couldn't cache noise in " << path << std::endl;
+			return;
+		}
+	}
+	std::rename(temporary.c_str(), path.c_str());
+	std::chrono::duration<float, std::milli> elapsed(std::chrono::steady_clock::now() - start);
+	time = elapsed.count();
+}
@@ -0,0 +1,35 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#pragma once
+
+#include <string>
+
+// baked noise textures kept on disk, named by
+// a hash of everything that goes into a bake:
+// dimensions, resolution, persistance,
+// subdivisions, seed and generator version.
+// a file is a small header and the r8 texels
+// of the base level, x fastest. loads map the
+// file and upload straight from the mapping.
+class noise_cache {
+	public:
+		// ms, last load or store
+		float time;
+		int hits;
+		int misses;
+
+		noise_cache(const std::string& folder = "./cache/");
+
+		// uploads a cached bake into level 0 of the
+		// bound GL_TEXTURE_3D (volume) or
+		// GL_TEXTURE_2D. false if there isn't one
+		bool load(bool volume, int resolution, float persistance, const int subdivisions[3], int seed);
+		// resolution^3 or resolution^2 texels
+		void store(bool volume, int resolution, float persistance, const int subdivisions[3], int seed, const unsigned char* texels);
+
+	private:
+		std::string folder;
+};
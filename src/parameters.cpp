@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#include <iostream>
+#include <cstring>
+#include <cstddef>
+#include <GL/glew.h>
+#include "parameters.h"
+#include "shader.h"
+
+parameter_buffer::parameter_buffer(unsigned int binding, int copies) : binding(binding), copies(copies), copy(0), mapped(nullptr), uploaded(false) {
+	// every copy starts at an offset the
+	// implementation can bind
+	int alignment;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	stride = (sizeof(parameters) + alignment - 1) / alignment * alignment;
+
+	glGenBuffers(1, &buffer_id);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer_id);
+	persistent = GLEW_ARB_buffer_storage;
+	if (persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, stride * copies, NULL, flags);
+		mapped = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, stride * copies, flags);
+	} else {
+		// a single copy, updated in place
+		this->copies = 1;
+		glBufferData(GL_UNIFORM_BUFFER, stride, NULL, GL_DYNAMIC_DRAW);
+	}
+	fences.resize(this->copies, nullptr);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+parameter_buffer::~parameter_buffer() {
+	for (GLsync fence : fences) {
+		if (fence) glDeleteSync(fence);
+	}
+	if (persistent) {
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer_id);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	glDeleteBuffers(1, &buffer_id);
+}
+
+bool parameter_buffer::update(const parameters& data) {
+	if (uploaded && std::memcmp(&data, &last, sizeof(parameters)) == 0) {
+		return false;
+	}
+	last = data;
+	uploaded = true;
+
+	if (!persistent) {
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer_id);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(parameters), &data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer_id);
+		return true;
+	}
+
+	// the copy in use is done with once the
+	// commands submitted so far are. move to
+	// the next one, waiting for the gpu if it
+	// still reads it.
+	if (fences[copy]) glDeleteSync(fences[copy]);
+	fences[copy] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	copy = (copy + 1) % copies;
+	if (fences[copy]) {
+		glClientWaitSync(fences[copy], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fences[copy]);
+		fences[copy] = nullptr;
+	}
+	std::memcpy(mapped + copy * stride, &data, sizeof(parameters));
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer_id, copy * stride, sizeof(parameters));
+	return true;
+}
+
+bool parameter_buffer::check(shader* program) {
+	struct member {
+		const char* name;
+		size_t offset;
+	};
+	const member members[] = {
+		{ "light_direction", offsetof(parameters, light_direction) },
+		{ "cloud_absorption", offsetof(parameters, cloud_absorption) },
+		{ "inverse_light_direction", offsetof(parameters, inverse_light_direction) },
+		{ "cloud_density_threshold", offsetof(parameters, cloud_density_threshold) },
+		{ "cloud_location", offsetof(parameters, cloud_location) },
+		{ "cloud_density_multiplier", offsetof(parameters, cloud_density_multiplier) },
+		{ "cloud_volume", offsetof(parameters, cloud_volume) },
+		{ "cloud_volume_edge_fade_distance", offsetof(parameters, cloud_volume_edge_fade_distance) },
+		{ "noise_main_offset", offsetof(parameters, noise_main_offset) },
+		{ "noise_main_scale", offsetof(parameters, noise_main_scale) },
+		{ "noise_detail_offset", offsetof(parameters, noise_detail_offset) },
+		{ "noise_detail_scale", offsetof(parameters, noise_detail_scale) },
+		{ "noise_weather_offset", offsetof(parameters, noise_weather_offset) },
+		{ "noise_weather_scale", offsetof(parameters, noise_weather_scale) },
+		{ "noise_detail_weight", offsetof(parameters, noise_detail_weight) },
+		{ "wind_vector", offsetof(parameters, wind_vector) },
+		{ "wind_main_weight", offsetof(parameters, wind_main_weight) },
+		{ "wind_weather_weight", offsetof(parameters, wind_weather_weight) },
+		{ "wind_detail_weight", offsetof(parameters, wind_detail_weight) },
+		{ "background_color", offsetof(parameters, background_color) },
+		{ "render_volume_samples", offsetof(parameters, render_volume_samples) },
+		{ "render_adaptive_steps", offsetof(parameters, render_adaptive_steps) },
+		{ "render_step_min", offsetof(parameters, render_step_min) },
+		{ "render_step_max", offsetof(parameters, render_step_max) },
+		{ "render_in_scatter_samples", offsetof(parameters, render_in_scatter_samples) },
+		{ "render_shadowing_max_distance", offsetof(parameters, render_shadowing_max_distance) },
+		{ "render_shadowing_weight", offsetof(parameters, render_shadowing_weight) },
+		{ "render_empty_space_skipping", offsetof(parameters, render_empty_space_skipping) },
+		{ "render_noise_lod", offsetof(parameters, render_noise_lod) },
+		{ "render_light_volume", offsetof(parameters, render_light_volume) },
+		{ "render_temporal", offsetof(parameters, render_temporal) },
+		{ "render_sky", offsetof(parameters, render_sky) },
+		{ "render_sky_lut", offsetof(parameters, render_sky_lut) },
+		{ "noise_packed", offsetof(parameters, noise_packed) },
+		{ "noise_weather_clipmap", offsetof(parameters, noise_weather_clipmap) },
+		{ "noise_weather_clipmap_levels", offsetof(parameters, noise_weather_clipmap_levels) },
+		{ "noise_weather_clipmap_texel_size", offsetof(parameters, noise_weather_clipmap_texel_size) },
+		{ "noise_weather_clipmap_centers[0]", offsetof(parameters, noise_weather_clipmap_centers) },
+	};
+
+	bool matches = true;
+	int size = program->uniform_block_size("parameters");
+	if (size == -1) {
+		std::cout << "[-] Program " << program->program_id << " has no parameters block" << std::endl;
+		return false;
+	}
+	if (size != (int)sizeof(parameters)) {
+		std::cout << "[-] Parameters block is " << size << " bytes, struct is " << sizeof(parameters) << std::endl;
+		matches = false;
+	}
+	for (const member& m : members) {
+		int offset = program->uniform_offset(m.name);
+		// members a program doesn't use may be
+		// optimised away
+		if (offset != -1 && offset != (int)m.offset) {
+			std::cout << "[-] Parameter " << m.name << " is at " << offset << ", struct has it at " << m.offset << std::endl;
+			matches = false;
+		}
+	}
+	return matches;
+}
@@ -0,0 +1,98 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#pragma once
+
+#include <vector>
+
+class shader;
+typedef struct __GLsync *GLsync;
+
+// mirror of the std140 parameters block in
+// data/parameters.glsl -> keep both in sync.
+struct parameters {
+	// light
+	float light_direction[3];
+	float cloud_absorption;
+	float inverse_light_direction[3];
+	float cloud_density_threshold;
+
+	// cloud
+	float cloud_location[3];
+	float cloud_density_multiplier;
+	float cloud_volume[3];
+	float cloud_volume_edge_fade_distance;
+
+	// noise
+	float noise_main_offset[3];
+	float noise_main_scale;
+	float noise_detail_offset[3];
+	float noise_detail_scale;
+	float noise_weather_offset[2];
+	float noise_weather_scale;
+	float noise_detail_weight;
+
+	// wind
+	float wind_vector[3];
+	float wind_main_weight;
+	float wind_weather_weight;
+	float wind_detail_weight;
+	int padding[2];
+
+	// skydome
+	float background_color[3];
+
+	// render
+	int render_volume_samples;
+	int render_adaptive_steps;
+	float render_step_min;
+	float render_step_max;
+	int render_in_scatter_samples;
+	float render_shadowing_max_distance;
+	float render_shadowing_weight;
+	int render_empty_space_skipping;
+	int render_noise_lod;
+	int render_light_volume;
+	int render_temporal;
+	int render_sky;
+	int render_sky_lut;
+
+	// noise modes
+	int noise_packed;
+	int noise_weather_clipmap;
+	int noise_weather_clipmap_levels;
+	float noise_weather_clipmap_texel_size;
+	int noise_weather_clipmap_centers[8][4]; // std140 arrays have a 16 byte stride
+};
+
+// uniform buffer holding the parameters block.
+// a persistently mapped ring of copies, so
+// that a new one can be written while the gpu
+// may still be reading the last one.
+class parameter_buffer {
+	public:
+		parameter_buffer(unsigned int binding, int copies = 3);
+		~parameter_buffer();
+
+		// uploads and binds the parameters, only
+		// if they differ from the last ones.
+		// returns whether they did.
+		bool update(const parameters& data);
+		// reports block members whose offset in
+		// a program doesn't match the struct's
+		bool check(shader* program);
+
+	private:
+		unsigned int buffer_id;
+		unsigned int binding;
+		int copies;
+		int copy;
+		int stride;
+		bool persistent;
+		char* mapped;
+		std::vector<GLsync> fences;
+		parameters last;
+		bool uploaded;
+};
@@ -0,0 +1,143 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#include <iostream>
+#include <fstream>
+#include <GL/glew.h>
+#include "profiler.h"
+#include "json.h"
+
+profiler::profiler(int latency) : tracing(false), current(0), gpu_open(false) {
+	frames.resize(latency);
+	for (frame_queries& f : frames) {
+		f.used = 0;
+	}
+	// lines gpu timestamps up with the cpu's.
+	// both clocks run at the same rate, so
+	// once is enough.
+	epoch = std::chrono::steady_clock::now();
+	GLint64 gpu_now;
+	glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+	gpu_offset = gpu_now;
+}
+
+profiler::~profiler() {
+	for (frame_queries& f : frames) {
+		for (query& q : f.queries) {
+			glDeleteQueries(1, &q.elapsed_id);
+			glDeleteQueries(1, &q.start_id);
+		}
+	}
+}
+
+void profiler::frame() {
+	if (gpu_open) gpu_end();
+	current = (current + 1) % frames.size();
+	collect(frames[current]);
+}
+
+void profiler::gpu_begin(const char* name) {
+	if (gpu_open) gpu_end();
+	frame_queries& f = frames[current];
+	if (f.used == (int)f.queries.size()) {
+		query q;
+		glGenQueries(1, &q.elapsed_id);
+		glGenQueries(1, &q.start_id);
+		f.queries.push_back(q);
+	}
+	query& q = f.queries[f.used];
+	q.name = name;
+	glQueryCounter(q.start_id, GL_TIMESTAMP);
+	glBeginQuery(GL_TIME_ELAPSED, q.elapsed_id);
+	gpu_open = true;
+}
+
+void profiler::gpu_end() {
+	if (!gpu_open) {
+		return;
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+	++frames[current].used;
+	gpu_open = false;
+}
+
+void profiler::cpu_begin(const char* name) {
+	cpu_scopes.push_back({ name, std::chrono::steady_clock::now() });
+}
+
+void profiler::cpu_end() {
+	if (cpu_scopes.empty()) {
+		return;
+	}
+	cpu_scope scope = cpu_scopes.back();
+	cpu_scopes.pop_back();
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::chrono::duration<double, std::micro> start(scope.start - epoch);
+	std::chrono::duration<double, std::micro> duration(now - scope.start);
+	record(scope.name, false, start.count(), duration.count());
+}
+
+void profiler::flush() {
+	if (gpu_open) gpu_end();
+	for (int i = 1; i <= (int)frames.size(); ++i) {
+		collect(frames[(current + i) % frames.size()]);
+	}
+}
+
+// a few frames have passed, the results are
+// there by now or close to
+void profiler::collect(frame_queries& f) {
+	for (int i = 0; i < f.used; ++i) {
+		GLuint64 elapsed, start;
+		glGetQueryObjectui64v(f.queries[i].elapsed_id, GL_QUERY_RESULT, &elapsed);
+		glGetQueryObjectui64v(f.queries[i].start_id, GL_QUERY_RESULT, &start);
+		record(f.queries[i].name, true, ((long long)start - gpu_offset) / 1000.0, elapsed / 1000.0);
+	}
+	f.used = 0;
+}
+
+void profiler::record(const char* name, bool gpu, double start, double duration) {
+	float ms = duration / 1000.0;
+	stat* s = nullptr;
+	for (stat& candidate : stats) {
+		if (candidate.gpu == gpu && candidate.name == name) {
+			s = &candidate;
+		}
+	}
+	if (s == nullptr) {
+		stats.push_back({ name, gpu, ms, ms });
+		s = &stats.back();
+	}
+	s->last = ms;
+	s->average += (ms - s->average) * 0.05f;
+	if (tracing) {
+		events.push_back({ name, gpu, start, duration });
+	}
+}
+
+bool profiler::export_trace(const std::string& path) {
+	std::ofstream file(path);
+	if (!file) {
+		std::cout << "[-] Couldn't write " << path << std::endl;
+		return false;
+	}
+	// one process, the cpu and the gpu as
+	// threads of it
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"cpu\"}}," << std::endl;
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"gpu\"}}";
+	file.precision(3);
+	file << std::fixed;
+	for (const event& e : events) {
+		file << "," << std::endl << "{\"name\":\"" << json_escape(e.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (e.gpu ? 2 : 1)
+			<< ",\"ts\":" << e.start << ",\"dur\":" << e.duration << "}";
+	}
+	file << std::endl << "]}" << std::endl;
+	return (bool)file;
+}
+
+void profiler::clear_trace() {
+	events.clear();
+}
@@ -0,0 +1,83 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+// where a frame's time goes. gpu passes are
+// timed with GL_TIME_ELAPSED queries, read
+// back a few frames later so they never
+// stall. cpu scopes use the steady clock.
+// every scope feeds a rolling average, and
+// while tracing also a chrome trace event
+// (chrome://tracing, ui.perfetto.dev).
+class profiler {
+	public:
+		struct stat {
+			std::string name;
+			bool gpu;
+			// ms, last result and rolling average
+			float last;
+			float average;
+		};
+		std::vector<stat> stats;
+		bool tracing;
+
+		// frames a query is given before its
+		// result is read
+		profiler(int latency = 4);
+		~profiler();
+
+		// call once per frame, before any scope
+		void frame();
+		// gpu scopes can't nest, a new one ends
+		// the open one. cpu scopes can.
+		void gpu_begin(const char* name);
+		void gpu_end();
+		void cpu_begin(const char* name);
+		void cpu_end();
+
+		// reads every query still in flight.
+		// waits for the gpu.
+		void flush();
+		// events recorded while tracing
+		bool export_trace(const std::string& path);
+		void clear_trace();
+
+	private:
+		struct query {
+			const char* name;
+			unsigned int elapsed_id;
+			unsigned int start_id;
+		};
+		struct frame_queries {
+			std::vector<query> queries;
+			int used;
+		};
+		struct cpu_scope {
+			const char* name;
+			std::chrono::steady_clock::time_point start;
+		};
+		struct event {
+			std::string name;
+			bool gpu;
+			double start; // us
+			double duration; // us
+		};
+		std::vector<frame_queries> frames;
+		int current;
+		bool gpu_open;
+		std::vector<cpu_scope> cpu_scopes;
+		std::vector<event> events;
+		std::chrono::steady_clock::time_point epoch;
+		// gpu clock minus steady clock, in ns
+		long long gpu_offset;
+
+		void collect(frame_queries& queries);
+		void record(const char* name, bool gpu, double start, double duration);
+};
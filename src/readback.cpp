@@ -0,0 +1,93 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#include <iostream>
+#include <GL/glew.h>
+#include "readback.h"
+
+pixel_readback::pixel_readback(int width, int height, int slots, bool bgr) : width(width), height(height), latency(0.0f), latency_frames(0), head(0), count(0), mapped(-1), requests(0), bgr(bgr) {
+	this->slots.resize(slots);
+	for (slot& s : this->slots) {
+		glGenBuffers(1, &s.buffer_id);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer_id);
+		glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 3, NULL, GL_STREAM_READ);
+		s.fence = nullptr;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+pixel_readback::~pixel_readback() {
+	if (mapped >= 0) unmap();
+	for (slot& s : slots) {
+		if (s.fence) glDeleteSync(s.fence);
+		glDeleteBuffers(1, &s.buffer_id);
+	}
+}
+
+void pixel_readback::request(int tag) {
+	if (full()) {
+		std::cout << "[-] Pixel readback requested with every slot in flight" << std::endl;
+		return;
+	}
+	slot& s = slots[(head + count) % slots.size()];
+	// rows are tightly packed. the read goes
+	// into the buffer, not client memory, so
+	// the call returns right away. the gpu does
+	// the swizzle to opencv's channel order.
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer_id);
+	glReadPixels(0, 0, width, height, bgr ? GL_BGR : GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	s.tag = tag;
+	s.frame = requests++;
+	s.time = std::chrono::steady_clock::now();
+	++count;
+}
+
+const unsigned char* pixel_readback::map(bool wait, int* tag) {
+	if (mapped >= 0 || count == 0) {
+		return nullptr;
+	}
+	slot& s = slots[head];
+	// the flush makes sure the fence gets to
+	// the gpu, or it would never signal
+	GLenum status = glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		return nullptr;
+	}
+	std::chrono::duration<float, std::milli> elapsed(std::chrono::steady_clock::now() - s.time);
+	latency = elapsed.count();
+	latency_frames = (int)(requests - s.frame - 1);
+	glDeleteSync(s.fence);
+	s.fence = nullptr;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer_id);
+	const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, width * height * 3, GL_MAP_READ_BIT);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (tag) *tag = s.tag;
+	mapped = head;
+	return pixels;
+}
+
+void pixel_readback::unmap() {
+	if (mapped < 0) {
+		return;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[mapped].buffer_id);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	mapped = -1;
+	head = (head + 1) % slots.size();
+	--count;
+}
+
+int pixel_readback::pending() {
+	return count;
+}
+
+bool pixel_readback::full() {
+	return count == (int)slots.size();
+}
@@ -0,0 +1,60 @@
+/*
+ * MIT License
+ * Copyright (c) 2020 Pablo Peñarroja
+ */
+
+#pragma once
+
+#include <vector>
+#include <chrono>
+
+typedef struct __GLsync *GLsync;
+
+// asynchronous reads of the screen. each one
+// is copied into a pixel buffer object on the
+// gpu's timeline and fenced, then mapped some
+// frames later once the fence has signaled,
+// so recording doesn't stall on glReadPixels.
+class pixel_readback {
+	public:
+		int width;
+		int height;
+		// time from request to signaled fence of
+		// the last mapped read, and how many
+		// frames were in flight with it
+		float latency;
+		int latency_frames;
+
+		// bgr for opencv, rgb otherwise
+		pixel_readback(int width, int height, int slots = 3, bool bgr = true);
+		~pixel_readback();
+
+		// reads the bound read framebuffer. tag is
+		// handed back by map(). there has to be a
+		// free slot -> map the oldest when full().
+		void request(int tag = 0);
+		// oldest finished read, tightly packed
+		// rows from the bottom up. nullptr if there
+		// isn't one. wait blocks until the oldest
+		// in flight is done instead.
+		const unsigned char* map(bool wait = false, int* tag = nullptr);
+		void unmap();
+		// reads in flight
+		int pending();
+		bool full();
+
+	private:
+		struct slot {
+			unsigned int buffer_id;
+			GLsync fence;
+			int tag;
+			unsigned long long frame;
+			std::chrono::steady_clock::time_point time;
+		};
+		std::vector<slot> slots;
+		int head;
+		int count;
+		int mapped;
+		unsigned long long requests;
+		bool bgr;
+};
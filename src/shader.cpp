@@ -5,6 +5,11 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <iterator>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <GL/glew.h>
 #include "shader.h"
 
@@ -15,113 +20,462 @@ std::string shader::parse_shader(const char* dir, bool write_string) {
 	}
   std::string line, ret = "";
 
-	std::ofstream outto;
-	if (write_string) {
-		std::string ss(dir);
-		ss += "STRING";
-		outto = std::ofstream(ss.c_str());
-	}
+	// includes are resolved relative to the
+	// including file
+	std::string folder(dir);
+	folder = folder.substr(0, folder.find_last_of('/') + 1);
     
   for (; std::getline(file, line); ret += '\n') {
+		if (line.rfind("#include \"", 0) == 0) {
+			std::string include = line.substr(10, line.find('"', 10) - 10);
+			ret += parse_shader((folder + include).c_str(), false);
+			continue;
+		}
     ret += line;
-		if (write_string) {
+  }
+
+	if (write_string) {
+		std::string ss(dir);
+		ss += "STRING";
+		std::ofstream outto(ss.c_str());
+		std::istringstream expanded(ret);
+		while (std::getline(expanded, line)) {
 			// "...\n" -> gotta learn regex
 			outto << char(34) << line << char(92) << "n" << char(34) << '\n';
 		}
-  }
+	}
 
   return ret;
 }
 
-int shader::compile_shader(unsigned int type, const char* src) {
+// status isn't queried here: that would wait
+// for the compile. complete() reports errors.
+unsigned int shader::compile_shader(unsigned int type, const char* src) {
   unsigned int id = glCreateShader(type);
   glShaderSource(id, 1, &src, nullptr);
   glCompileShader(id);
-
-  // check if it compiled
-  int res;
-  glGetShaderiv(id, GL_COMPILE_STATUS, &res);
-  if (res) {
-    return id;
-  }
-
-  // compilation failed. exception handling
-  int len;
-  glGetShaderiv(id, GL_INFO_LOG_LENGTH, &len);
-  char* message = (char*)alloca(len * sizeof(char));
-  glGetShaderInfoLog(id, len, &len, message);
-  std::cout << "Failed to compile " << (type == GL_VERTEX_SHADER ? "vertex" : (type == GL_FRAGMENT_SHADER ? "fragment" : "compute")) << " shader:" << std::endl << message << std::endl;
-    
-  return -1;
+  return id;
 }
 
 int shader::get_uniform_location(const char* name) {
-  if (uniform_map.find(name) != uniform_map.end()) {
-    return uniform_map[name];
+  auto cached = uniform_map.find(name);
+  if (cached != uniform_map.end()) {
+    return cached->second;
   }
 
-  unsigned int location = glGetUniformLocation(program_id, name);
-
-  if (location == -1) {
+	// names are checked against the program's
+	// reflection once. missing ones are
+	// ignored, reported here only if no link
+	// has known them yet.
+	int location = -1;
+	bool known = !expected_uniforms.insert(name).second;
+	auto reflected = uniform_locations.find(name);
+	if (reflected != uniform_locations.end()) {
+		location = reflected->second;
+	} else if (!known) {
 		std::cout << "couldn't find " << name << " uniform" << std::endl;
-    return -1;
-  }
+	}
 
   uniform_map[name] = location;
     
   return location;
 }
 
-shader::shader(std::string compute, bool read_from_file) {
-	std::string strc;
-	if (read_from_file) {
-		strc = parse_shader(compute.c_str(), false);
-	} else {
-		strc = compute.c_str();
+// texture unit left to samplers of a type
+// nothing has been bound to yet. unit 0 is
+// shared by all of them otherwise, and
+// samplers of different types on one unit
+// make every draw fail.
+static int spare_texture_unit(GLenum type) {
+	static const GLenum types[] = {
+		GL_SAMPLER_2D, GL_SAMPLER_3D, GL_SAMPLER_2D_ARRAY, GL_SAMPLER_CUBE,
+		GL_INT_SAMPLER_2D, GL_INT_SAMPLER_3D, GL_UNSIGNED_INT_SAMPLER_2D, GL_UNSIGNED_INT_SAMPLER_3D
+	};
+	int units;
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &units);
+	for (int i = 0; i < (int)(sizeof(types) / sizeof(types[0])); ++i) {
+		if (types[i] == type) return units - 1 - i;
 	}
-	unsigned int program = glCreateProgram();
-	unsigned int cs = compile_shader(GL_COMPUTE_SHADER, strc.c_str());
-	glAttachShader(program, cs);
-	glLinkProgram(program);
-	glValidateProgram(program);
-	glDeleteShader(cs);
-	program_id = program;
+	return -1;
 }
 
-shader::shader(std::string vert, std::string frag, bool read_from_file) {
-	std::string strv, strf;
-	if (read_from_file) {
-		if (vert.size()) {
-			strv = parse_shader(vert.c_str(), false);
+// active uniforms outside of blocks, by name.
+// right after every link
+void shader::reflect() {
+	int count, max_length;
+	glGetProgramInterfaceiv(program_id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+	glGetProgramInterfaceiv(program_id, GL_UNIFORM, GL_MAX_NAME_LENGTH, &max_length);
+	std::string name(max_length, '\0');
+	const GLenum properties[3] = { GL_LOCATION, GL_BLOCK_INDEX, GL_TYPE };
+	for (int i = 0; i < count; ++i) {
+		int values[3];
+		int length;
+		glGetProgramResourceName(program_id, GL_UNIFORM, i, max_length, &length, &name[0]);
+		glGetProgramResourceiv(program_id, GL_UNIFORM, i, 3, properties, 3, nullptr, values);
+		if (values[1] != -1) continue;
+		int unit = spare_texture_unit(values[2]);
+		if (unit >= 0) {
+			int current;
+			glGetUniformiv(program_id, values[0], &current);
+			if (current == 0) glProgramUniform1i(program_id, values[0], unit);
+		}
+		std::string uniform = name.substr(0, length);
+		uniform_locations[uniform] = values[0];
+		// arrays can be set from their name alone
+		if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0) {
+			uniform_locations[uniform.substr(0, uniform.size() - 3)] = values[0];
+		}
+	}
+	// uniforms the previous builds were given
+	// and this one lost or renamed
+	for (const std::string& uniform : expected_uniforms) {
+		if (!uniform_locations.count(uniform)) {
+			std::cout << "couldn't find " << uniform << " uniform" << std::endl;
 		}
-		strf = parse_shader(frag.c_str(), false);
-	} else {
-		strv = vert.c_str();
-		strf = frag.c_str();
 	}
+}
+
+int shader::uniform_block_size(const char* block) {
+	if (!program_id) finish();
+	unsigned int index = glGetProgramResourceIndex(program_id, GL_UNIFORM_BLOCK, block);
+	if (index == GL_INVALID_INDEX) {
+		return -1;
+	}
+	const GLenum property = GL_BUFFER_DATA_SIZE;
+	int size;
+	glGetProgramResourceiv(program_id, GL_UNIFORM_BLOCK, index, 1, &property, 1, nullptr, &size);
+	return size;
+}
 
-	unsigned int program = glCreateProgram();
-	unsigned int vs;
-	if (vert.size()) vs = compile_shader(GL_VERTEX_SHADER, strv.c_str());
-	unsigned int fs = compile_shader(GL_FRAGMENT_SHADER, strf.c_str());
+int shader::uniform_offset(const char* name) {
+	if (!program_id) finish();
+	unsigned int index = glGetProgramResourceIndex(program_id, GL_UNIFORM, name);
+	if (index == GL_INVALID_INDEX) {
+		return -1;
+	}
+	const GLenum property = GL_OFFSET;
+	int offset;
+	glGetProgramResourceiv(program_id, GL_UNIFORM, index, 1, &property, 1, nullptr, &offset);
+	return offset;
+}
 
-	if (vert.size()) glAttachShader(program, vs);
-	glAttachShader(program, fs);
-	glLinkProgram(program);
-	glValidateProgram(program);
+// ---- program binary cache ---- //
 
-	if (vert.size()) glDeleteShader(vs);
-	glDeleteShader(fs);
+// programs are cached in ./cache/ under a hash
+// of everything that goes into them
+static const char* cache_folder = "./cache/";
+
+// fnv-1a
+static unsigned long long cache_hash(unsigned long long hash, const std::string& text) {
+	for (unsigned char c : text) {
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
 
+static std::string cache_path(const std::string& key) {
+	return cache_folder + key + ".bin";
+}
+
+static bool cache_load(unsigned int program, const std::string& key) {
+	if (!GLEW_ARB_get_program_binary) {
+		return false;
+	}
+	std::ifstream file(cache_path(key), std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	unsigned int format;
+	file.read((char*)&format, sizeof(format));
+	std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (!file.eof() || binary.empty()) {
+		return false;
+	}
+	glProgramBinary(program, format, &binary[0], binary.size());
+	// a driver update can turn the binary down
+	int linked;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	return linked;
+}
+
+static void cache_store(unsigned int program, const std::string& key) {
+	if (!GLEW_ARB_get_program_binary) {
+		return;
+	}
+	int length;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+	std::vector<char> binary(length);
+	unsigned int format;
+	glGetProgramBinary(program, length, &length, &format, &binary[0]);
+	mkdir(cache_folder, 0755);
+	// written aside and renamed into place, so
+	// runs sharing the folder never read half
+	// a binary
+	std::string path = cache_path(key);
+	std::string temporary = path + ".tmp" + std::to_string(getpid());
+	{
+		std::ofstream file(temporary, std::ios::binary);
+		file.write((const char*)&format, sizeof(format));
+		file.write(&binary[0], length);
+		if (!file) {
+			file.close();
+			std::remove(temporary.c_str());
+			return;
+		}
+	}
+	std::rename(temporary.c_str(), path.c_str());
+}
+
+// ---- uniform carry over ---- //
+
+// plain uniforms set on a program are copied
+// into the one replacing it, so a reload looks
+// the same as the program it replaces
+static void copy_program_uniforms(unsigned int from, unsigned int to) {
+	int count;
+	glGetProgramInterfaceiv(from, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+	const GLenum properties[4] = { GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION, GL_BLOCK_INDEX };
+	char name[256];
+	for (int i = 0; i < count; ++i) {
+		int values[4];
+		glGetProgramResourceiv(from, GL_UNIFORM, i, 4, properties, 4, nullptr, values);
+		if (values[3] != -1 || values[2] == -1) continue;
+		glGetProgramResourceName(from, GL_UNIFORM, i, sizeof(name), nullptr, name);
+		int location = glGetUniformLocation(to, name);
+		if (location == -1) continue;
+		for (int e = 0; e < values[1]; ++e) {
+			float f[16];
+			int n[4];
+			switch (values[0]) {
+				case GL_FLOAT:
+					glGetUniformfv(from, values[2] + e, f);
+					glProgramUniform1fv(to, location + e, 1, f);
+					break;
+				case GL_FLOAT_VEC2:
+					glGetUniformfv(from, values[2] + e, f);
+					glProgramUniform2fv(to, location + e, 1, f);
+					break;
+				case GL_FLOAT_VEC3:
+					glGetUniformfv(from, values[2] + e, f);
+					glProgramUniform3fv(to, location + e, 1, f);
+					break;
+				case GL_FLOAT_VEC4:
+					glGetUniformfv(from, values[2] + e, f);
+					glProgramUniform4fv(to, location + e, 1, f);
+					break;
+				case GL_FLOAT_MAT4:
+					glGetUniformfv(from, values[2] + e, f);
+					glProgramUniformMatrix4fv(to, location + e, 1, GL_FALSE, f);
+					break;
+				case GL_INT_VEC2:
+					glGetUniformiv(from, values[2] + e, n);
+					glProgramUniform2iv(to, location + e, 1, n);
+					break;
+				case GL_INT_VEC3:
+					glGetUniformiv(from, values[2] + e, n);
+					glProgramUniform3iv(to, location + e, 1, n);
+					break;
+				case GL_INT_VEC4:
+					glGetUniformiv(from, values[2] + e, n);
+					glProgramUniform4iv(to, location + e, 1, n);
+					break;
+				default:
+					// ints, samplers and images
+					glGetUniformiv(from, values[2] + e, n);
+					glProgramUniform1iv(to, location + e, 1, n);
+					break;
+			}
+		}
+	}
+}
+
+// ---- build ---- //
+
+shader::shader(std::string compute, bool read_from_file, std::string defines) : read_from_file(read_from_file), defines(defines), pending_id(0), program_id(0) {
+	stage_types = { GL_COMPUTE_SHADER };
+	stage_sources = { compute };
+	build();
+}
+
+shader::shader(std::string vert, std::string frag, bool read_from_file, std::string defines) : read_from_file(read_from_file), defines(defines), pending_id(0), program_id(0) {
+	if (vert.size()) {
+		stage_types.push_back(GL_VERTEX_SHADER);
+		stage_sources.push_back(vert);
+	}
+	stage_types.push_back(GL_FRAGMENT_SHADER);
+	stage_sources.push_back(frag);
+	build();
+}
+
+void shader::build() {
+	static bool parallel = GLEW_KHR_parallel_shader_compile;
+	static bool threads = false;
+	if (parallel && !threads) {
+		// let the driver use as many as it likes
+		glMaxShaderCompilerThreadsKHR(0xffffffff);
+		threads = true;
+	}
+
+	std::vector<std::string> sources;
+	for (const std::string& stage : stage_sources) {
+		std::string source = read_from_file ? parse_shader(stage.c_str(), false) : stage;
+		// defines go right after #version
+		if (defines.size()) {
+			size_t version = source.find("#version");
+			size_t line = version == std::string::npos ? 0 : source.find('\n', version) + 1;
+			source.insert(line, defines + '\n');
+		}
+		sources.push_back(source);
+	}
+
+	// the key covers the driver too: binaries
+	// don't survive driver updates
+	unsigned long long hash = 14695981039346656037ull;
+	hash = cache_hash(hash, (const char*)glGetString(GL_VENDOR));
+	hash = cache_hash(hash, (const char*)glGetString(GL_RENDERER));
+	hash = cache_hash(hash, (const char*)glGetString(GL_VERSION));
+	hash = cache_hash(hash, defines);
+	for (const std::string& source : sources) {
+		hash = cache_hash(hash, source);
+	}
+	char key[17];
+	snprintf(key, sizeof(key), "%016llx", hash);
+
+	// drop a build that's still in flight
+	if (pending_id) {
+		for (unsigned int stage : pending_stages) glDeleteShader(stage);
+		glDeleteProgram(pending_id);
+		pending_stages.clear();
+	}
+	pending_id = glCreateProgram();
+	pending_key = key;
+
+	if (cache_load(pending_id, pending_key)) {
+		complete();
+		return;
+	}
+
+	for (size_t i = 0; i < sources.size(); ++i) {
+		unsigned int stage = compile_shader(stage_types[i], sources[i].c_str());
+		glAttachShader(pending_id, stage);
+		pending_stages.push_back(stage);
+	}
+	glProgramParameteri(pending_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(pending_id);
+
+	// without parallel compilation the link
+	// has to be waited for anyway
+	if (!parallel) {
+		complete();
+	}
+}
+
+// the pending program is done compiling.
+// keep it if it linked.
+void shader::complete() {
+	unsigned int program = pending_id;
+	pending_id = 0;
+
+	int linked;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		// compilation failed. exception handling
+		for (size_t i = 0; i < pending_stages.size(); ++i) {
+			int compiled;
+			glGetShaderiv(pending_stages[i], GL_COMPILE_STATUS, &compiled);
+			if (compiled) continue;
+			int len;
+			glGetShaderiv(pending_stages[i], GL_INFO_LOG_LENGTH, &len);
+			std::string message(len, '\0');
+			glGetShaderInfoLog(pending_stages[i], len, &len, &message[0]);
+			unsigned int type = stage_types[i];
+			std::cout << "Failed to compile " << (type == GL_VERTEX_SHADER ? "vertex" : (type == GL_FRAGMENT_SHADER ? "fragment" : "compute")) << " shader:" << std::endl << message << std::endl;
+		}
+		int len;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &len);
+		if (len > 1) {
+			std::string message(len, '\0');
+			glGetProgramInfoLog(program, len, &len, &message[0]);
+			std::cout << "Failed to link program:" << std::endl << message << std::endl;
+		}
+	} else if (pending_stages.size()) {
+		// built from source, store it for the
+		// next run
+		cache_store(program, pending_key);
+	}
+
+	for (unsigned int stage : pending_stages) {
+		glDetachShader(program, stage);
+		glDeleteShader(stage);
+	}
+	pending_stages.clear();
+
+	if (!linked) {
+		glDeleteProgram(program);
+		return;
+	}
+
+	if (program_id) {
+		copy_program_uniforms(program_id, program);
+		int current;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+		if (current == (int)program_id) glUseProgram(program);
+		glDeleteProgram(program_id);
+	}
 	program_id = program;
+	uniform_map.clear();
+	uniform_locations.clear();
+	reflect();
+}
+
+void shader::copy_uniforms(shader* from) {
+	poll();
+	from->poll();
+	copy_program_uniforms(from->program_id, program_id);
+}
+
+void shader::reload(std::string defines) {
+	this->defines = defines;
+	build();
+}
+
+void shader::reload() {
+	build();
+}
+
+bool shader::compiling() {
+	return pending_id;
+}
+
+bool shader::poll() {
+	if (!pending_id) {
+		return false;
+	}
+	if (program_id) {
+		int done;
+		glGetProgramiv(pending_id, GL_COMPLETION_STATUS_KHR, &done);
+		if (!done) return false;
+	}
+	complete();
+	return true;
+}
+
+void shader::finish() {
+	if (pending_id) complete();
 }
 
 shader::~shader() {
+	if (!program_id) finish();
   glUseProgram(0);
   glDeleteProgram(program_id);
 }
 
 void shader::bind() {
+	poll();
 	glUseProgram(program_id);
 }
 
@@ -145,6 +499,10 @@ void shader::set4i(const char* name, int v1, int v2, int v3, int v4) {
   glUniform4i(get_uniform_location(name), v1, v2, v3, v4);
 }
 
+void shader::set2iv(const char* name, int count, const int* v) {
+  glUniform2iv(get_uniform_location(name), count, v);
+}
+
 void shader::set1f(const char* name, float v) {
   glUniform1f(get_uniform_location(name), v);
 }
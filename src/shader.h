@@ -6,30 +6,78 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <glm/glm.hpp>
 
 class shader {
 	private:
-		std::unordered_map<const char*, unsigned int> uniform_map;
+		std::unordered_map<const char*, int> uniform_map;
+		std::unordered_map<std::string, int> uniform_locations;
+		// names set on any build of the program.
+		// each link checks them once.
+		std::unordered_set<std::string> expected_uniforms;
+
+		// what the program is built from: the
+		// type of each stage and its file or its
+		// source
+		std::vector<unsigned int> stage_types;
+		std::vector<std::string> stage_sources;
+		bool read_from_file;
+		std::string defines;
+
+		// program being compiled in the background
+		// and its stages. program_id stays in use
+		// until it links.
+		unsigned int pending_id;
+		std::vector<unsigned int> pending_stages;
+		std::string pending_key;
 
 		std::string parse_shader(const char* dir, bool write_string);
-		int compile_shader(unsigned int type, const char* src);
+		unsigned int compile_shader(unsigned int type, const char* src);
 		int get_uniform_location(const char* name);
+		void reflect();
+		void build();
+		void complete();
 	public:
 		unsigned int program_id;
-		shader(std::string compute, bool read_from_file = true);
-		shader(std::string vert, std::string frag, bool read_from_file = true);
+		shader(std::string compute, bool read_from_file = true, std::string defines = "");
+		shader(std::string vert, std::string frag, bool read_from_file = true, std::string defines = "");
 		~shader();
 
 		void bind();
 		void unbind();
 
+		// rebuild from the same files with another
+		// set of defines. the current program is
+		// kept until the new one links.
+		void reload(std::string defines);
+		void reload();
+		// true while a build is in flight
+		bool compiling();
+		// swap in the new program if it's done.
+		// blocks only if there's no program yet.
+		bool poll();
+		// block until the pending build is done
+		void finish();
+
+		// take the values of the uniforms this
+		// program shares with another one
+		void copy_uniforms(shader* from);
+
+		// reflection.
+		// -1 if the block or uniform isn't active
+		int uniform_block_size(const char* block);
+		int uniform_offset(const char* name);
+
 		// uniform setters
 		void set1i(const char* name, int v);
 		void set2i(const char* name, int v1, int v2);
 		void set3i(const char* name, int v1, int v2, int v3);
 		void set4i(const char* name, int v1, int v2, int v3, int v4);
+		// arrays, from their first element
+		void set2iv(const char* name, int count, const int* v);
 		void set1f(const char* name, float v);
 		void set2f(const char* name, float v1, float v2);
 		void set3f(const char* name, float v1, float v2, float v3);
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+#
+# MIT License
+# Copyright (c) 2020 Pablo Peñarroja
+#
+# compares two `ao --headless --bench` results.
+# configurations are matched by name, and any
+# frame time or bake time that got slower by
+# more than the threshold is a regression.
+#
+#   bench_compare.py baseline.json current.json [--threshold 5]
+#
+
+import json
+import sys
+
+def main():
+	args = [a for a in sys.argv[1:]]
+	threshold = 5.0
+	if "--threshold" in args:
+		i = args.index("--threshold")
+		threshold = float(args[i + 1])
+		del args[i:i + 2]
+	if len(args) != 2:
+		print("usage: bench_compare.py baseline.json current.json [--threshold percent]")
+		return 2
+	with open(args[0]) as f:
+		baseline = json.load(f)
+	with open(args[1]) as f:
+		current = json.load(f)
+
+	if baseline["renderer"] != current["renderer"]:
+		print("[!] renderers differ: '%s' vs '%s'" % (baseline["renderer"], current["renderer"]))
+
+	regressions = 0
+
+	def compare(name, before, after):
+		nonlocal regressions
+		if before <= 0.0:
+			return
+		change = (after - before) / before * 100.0
+		mark = "  "
+		if change > threshold:
+			mark = "[-]"
+			regressions += 1
+		elif change < -threshold:
+			mark = "[+]"
+		print("%s %-48s %9.3f -> %9.3f ms  %+6.1f%%" % (mark, name, before, after, change))
+
+	for preset, before in baseline.get("bakes", {}).items():
+		if preset in current.get("bakes", {}):
+			compare("bake " + preset, before, current["bakes"][preset])
+
+	configurations = {c["name"]: c for c in current["configurations"]}
+	for before in baseline["configurations"]:
+		after = configurations.get(before["name"])
+		if after is None:
+			print("[!] %s missing from %s" % (before["name"], args[1]))
+			continue
+		for stat in ("mean", "p50", "p95", "p99"):
+			compare(before["name"] + " " + stat, before[stat], after[stat])
+
+	print("%d regressions over %.1f%%" % (regressions, threshold))
+	return 1 if regressions else 0
+
+if __name__ == "__main__":
+	sys.exit(main())